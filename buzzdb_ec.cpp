@@ -18,12 +18,35 @@
 #include <shared_mutex>
 #include <cassert>
 #include <cstring> 
+#include <cstddef>
 #include <exception>
 #include <atomic>
 #include <set>
 #include <variant>
+#include <tuple>
+#include <utility>
+#include <numeric>
 #include <stdexcept>
 #include <unordered_set>
+#include <array>
+#include <deque>
+#include <condition_variable>
+#include <functional>
+#include <string_view>
+#include <charconv>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BUZZDB_HAVE_IO_URING
+#endif
 
 #define UNUSED(p)  ((void)(p))
 
@@ -185,10 +208,154 @@ public:
     }
 };
 
+// Fixed set of worker threads consuming a FIFO task queue
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    bool stopping = false;
+
+public:
+    explicit ThreadPool(size_t num_threads) {
+        for (size_t i = 0; i < std::max<size_t>(num_threads, 1); ++i) {
+            workers.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                        if (stopping && tasks.empty()) {
+                            return;
+                        }
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        task_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        task_available.notify_one();
+    }
+
+    // Split [0, count) into chunks of `grain` that the workers pick up dynamically and call
+    // fn(worker_index, begin, end) on each; returns once every chunk is done
+    template <typename Fn>
+    void parallelFor(size_t count, size_t grain, Fn&& fn) {
+        std::atomic<size_t> next_chunk{0};
+        size_t remaining = workers.size();
+        std::mutex done_mutex;
+        std::condition_variable done;
+
+        for (size_t worker = 0; worker < workers.size(); ++worker) {
+            submit([&, worker] {
+                while (true) {
+                    size_t begin = next_chunk.fetch_add(grain);
+                    if (begin >= count) {
+                        break;
+                    }
+                    fn(worker, begin, std::min(begin + grain, count));
+                }
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (--remaining == 0) {
+                    done.notify_one();
+                }
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done.wait(lock, [&] { return remaining == 0; });
+    }
+};
+
+// Reader-writer latch that admits no new reader while a writer waits, so a stream of
+// short shared holds cannot keep a writer out (std::shared_mutex on glibc prefers
+// readers). A writer waits only for the holds already taken. Not recursive.
+class WriterPreferringLatch {
+private:
+    std::mutex mutex;
+    std::condition_variable readers_cv;
+    std::condition_variable writers_cv;
+    size_t active_readers = 0;
+    size_t waiting_writers = 0;
+    bool writing = false;
+
+public:
+    void lock() {
+        std::unique_lock<std::mutex> guard(mutex);
+        waiting_writers++;
+        writers_cv.wait(guard, [this] { return !writing && active_readers == 0; });
+        waiting_writers--;
+        writing = true;
+    }
+
+    void unlock() {
+        bool writer_next;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            writing = false;
+            writer_next = waiting_writers > 0;
+        }
+        if (writer_next) {
+            writers_cv.notify_one();
+        } else {
+            readers_cv.notify_all();
+        }
+    }
+
+    void lock_shared() {
+        std::unique_lock<std::mutex> guard(mutex);
+        readers_cv.wait(guard, [this] { return !writing && waiting_writers == 0; });
+        active_readers++;
+    }
+
+    bool try_lock_shared() {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (writing || waiting_writers > 0) {
+            return false;
+        }
+        active_readers++;
+        return true;
+    }
+
+    void unlock_shared() {
+        bool writer_next;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            writer_next = --active_readers == 0 && waiting_writers > 0;
+        }
+        if (writer_next) {
+            writers_cv.notify_one();
+        }
+    }
+};
+
 static constexpr size_t PAGE_SIZE = 4096;  // Fixed page size
 // static constexpr size_t PAGE_SIZE = 32408;  // Fixed page size
-static constexpr size_t MAX_SLOTS = 512;   // Fixed number of slots
-static constexpr size_t MAX_PAGES= 1000;   // Total Number of pages that can be stored
+static constexpr size_t MAX_SLOTS = 128;   // Fixed number of slots
 uint16_t INVALID_VALUE = std::numeric_limits<uint16_t>::max(); // Sentinel value
 
 struct Slot {
@@ -198,9 +365,29 @@ struct Slot {
 };
 
 // Slotted Page class
+// Page buffers are aligned to the page size so they can be used for O_DIRECT I/O
+// A non-owning deleter marks a view of memory owned elsewhere (a file mapping).
+struct AlignedPageDeleter {
+    bool owned = true;
+
+    void operator()(char* data) const {
+        if (owned) {
+            ::operator delete[](data, std::align_val_t(PAGE_SIZE));
+        }
+    }
+};
+using PageBuffer = std::unique_ptr<char[], AlignedPageDeleter>;
+
+inline PageBuffer allocatePageBuffer() {
+    return PageBuffer(new (std::align_val_t(PAGE_SIZE)) char[PAGE_SIZE]());
+}
+
 class SlottedPage {
 public:
-    std::unique_ptr<char[]> page_data = std::make_unique<char[]>(PAGE_SIZE);
+    // The last bytes of every page hold the LSN of its latest logged update
+    static constexpr size_t LSN_OFFSET = PAGE_SIZE - sizeof(uint64_t);
+
+    PageBuffer page_data = allocatePageBuffer();
     size_t metadata_size = sizeof(Slot) * MAX_SLOTS;
 
     SlottedPage(){
@@ -213,6 +400,10 @@ public:
         }
     }
 
+    // View of a page that lives in a read-only file mapping; must not be modified
+    explicit SlottedPage(const char* mapped_data)
+        : page_data(const_cast<char*>(mapped_data), AlignedPageDeleter{false}) {}
+
     // Add a tuple, returns true if it fits, false otherwise.
     bool addTuple(std::unique_ptr<Tuple> tuple) {
 
@@ -221,76 +412,181 @@ public:
         size_t tuple_size = serializedTuple.size();
 
         //std::cout << "Tuple size: " << tuple_size << " bytes\n";
-        assert(tuple_size == 38);
-
-        // Check for first slot with enough space
-        size_t slot_itr = 0;
-        Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());        
-        for (; slot_itr < MAX_SLOTS; slot_itr++) {
-            if (slot_array[slot_itr].empty == true and 
-                slot_array[slot_itr].length >= tuple_size) {
-                break;
+        if (!addRecord(serializedTuple.c_str(), tuple_size).has_value()) {
+            if (freeSpace() < tuple_size) {
+                return false;
             }
+            compact();
+            return addRecord(serializedTuple.c_str(), tuple_size).has_value();
         }
-        if (slot_itr == MAX_SLOTS){
-            //std::cout << "Page does not contain an empty slot with sufficient space to store the tuple.";
-            return false;
-        }
+        return true;
+    }
 
-        // Identify the offset where the tuple will be placed in the page
-        // Update slot meta-data if needed
-        slot_array[slot_itr].empty = false;
-        size_t offset = INVALID_VALUE;
-        if (slot_array[slot_itr].offset == INVALID_VALUE){
-            if(slot_itr != 0){
-                auto prev_slot_offset = slot_array[slot_itr - 1].offset;
-                auto prev_slot_length = slot_array[slot_itr - 1].length;
-                offset = prev_slot_offset + prev_slot_length;
-            }
-            else{
-                offset = metadata_size;
+    // Add a raw record of any length in the first empty slot, returns the slot if the
+    // free space after the last record holds it. Space freed further up the page is only
+    // reusable after compact().
+    std::optional<uint16_t> addRecord(const char* record, size_t tuple_size) {
+        Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());
+        for (size_t slot_itr = 0; slot_itr < MAX_SLOTS; slot_itr++) {
+            if (slot_array[slot_itr].empty) {
+                if (!putRecord(static_cast<uint16_t>(slot_itr), record, tuple_size)) {
+                    return std::nullopt;
+                }
+                return static_cast<uint16_t>(slot_itr);
             }
+        }
+        //std::cout << "Page does not contain an empty slot.";
+        return std::nullopt;
+    }
 
-            slot_array[slot_itr].offset = offset;
+    // Store a record in the empty `slot`, after the last record of the page. Returns false
+    // if it does not fit there.
+    bool putRecord(uint16_t slot, const char* record, size_t tuple_size) {
+        Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());
+        assert(slot < MAX_SLOTS && slot_array[slot].empty);
+        size_t offset = heapEnd();
+        if (offset + tuple_size >= LSN_OFFSET) {
+            return false;
         }
-        else{
-            offset = slot_array[slot_itr].offset;
+        slot_array[slot].empty = false;
+        slot_array[slot].offset = static_cast<uint16_t>(offset);
+        slot_array[slot].length = static_cast<uint16_t>(tuple_size);
+        std::memcpy(page_data.get() + offset, record, tuple_size);
+        return true;
+    }
+
+    // Pointer to the record stored in `slot`, nullptr if the slot is empty
+    const char* getRecord(uint16_t slot) const {
+        Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());
+        if (slot >= MAX_SLOTS || slot_array[slot].empty) {
+            return nullptr;
         }
+        return page_data.get() + slot_array[slot].offset;
+    }
 
-        if(offset + tuple_size >= PAGE_SIZE){
-            slot_array[slot_itr].empty = true;
-            slot_array[slot_itr].offset = INVALID_VALUE;
+    // Overwrite the record in `slot`. A record that outgrew its slot moves to the free
+    // space after the last record, keeping the slot; returns false if it does not fit there.
+    // A shrunk record stays in place, and the bytes it no longer uses are reclaimed by compact().
+    bool updateRecord(uint16_t slot, const char* record, size_t tuple_size) {
+        Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());
+        if (slot >= MAX_SLOTS || slot_array[slot].empty) {
+            return false;
+        }
+        if (slot_array[slot].length >= tuple_size) {
+            std::memcpy(page_data.get() + slot_array[slot].offset, record, tuple_size);
+            slot_array[slot].length = static_cast<uint16_t>(tuple_size);
+            return true;
+        }
+        size_t offset = heapEnd();
+        if (offset + tuple_size >= LSN_OFFSET) {
             return false;
         }
+        slot_array[slot].offset = static_cast<uint16_t>(offset);
+        slot_array[slot].length = static_cast<uint16_t>(tuple_size);
+        std::memcpy(page_data.get() + offset, record, tuple_size);
+        return true;
+    }
+
+    // Empty a slot; its bytes become reusable once the page is compacted
+    void deleteTuple(size_t index) {
+        Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());
+        if (index < MAX_SLOTS && slot_array[index].empty == false) {
+            slot_array[index].empty = true;
+            slot_array[index].offset = INVALID_VALUE;
+            slot_array[index].length = INVALID_VALUE;
+        }
 
-        assert(offset != INVALID_VALUE);
-        assert(offset >= metadata_size);
-        assert(offset + tuple_size < PAGE_SIZE);
+        //std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
 
-        if (slot_array[slot_itr].length == INVALID_VALUE){
-            slot_array[slot_itr].length = tuple_size;
+    // End of the last record, where the next record goes
+    size_t heapEnd() const {
+        const Slot* slot_array = reinterpret_cast<const Slot*>(page_data.get());
+        size_t end = metadata_size;
+        for (size_t slot_itr = 0; slot_itr < MAX_SLOTS; slot_itr++) {
+            if (!slot_array[slot_itr].empty) {
+                end = std::max<size_t>(end, slot_array[slot_itr].offset + slot_array[slot_itr].length);
+            }
         }
+        return end;
+    }
 
-        // Copy serialized data into the page
-        std::memcpy(page_data.get() + offset, 
-                    serializedTuple.c_str(), 
-                    tuple_size);
+    // Bytes not used by any record, i.e. the largest record that fits after compact()
+    size_t unusedSpace() const {
+        const Slot* slot_array = reinterpret_cast<const Slot*>(page_data.get());
+        size_t used = 0;
+        for (size_t slot_itr = 0; slot_itr < MAX_SLOTS; slot_itr++) {
+            if (!slot_array[slot_itr].empty) {
+                used += slot_array[slot_itr].length;
+            }
+        }
+        return LSN_OFFSET - 1 - metadata_size - used;
+    }
 
-        return true;
+    // Largest record addRecord can take after compact(), 0 if every slot is in use
+    size_t freeSpace() const {
+        const Slot* slot_array = reinterpret_cast<const Slot*>(page_data.get());
+        for (size_t slot_itr = 0; slot_itr < MAX_SLOTS; slot_itr++) {
+            if (slot_array[slot_itr].empty) {
+                return unusedSpace();
+            }
+        }
+        return 0;
     }
 
-    void deleteTuple(size_t index) {
+    // Slide the records down to the slot array so the free space is one run at the end.
+    // Returns the slots whose record moved, in the order they were moved.
+    std::vector<uint16_t> compact() {
         Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());
-        size_t slot_itr = 0;
-        for (; slot_itr < MAX_SLOTS; slot_itr++) {
-            if(slot_itr == index and
-               slot_array[slot_itr].empty == false){
-                slot_array[slot_itr].empty = true;
-                break;
-               }
+        std::vector<uint16_t> live;
+        for (uint16_t slot_itr = 0; slot_itr < MAX_SLOTS; slot_itr++) {
+            if (!slot_array[slot_itr].empty) {
+                live.push_back(slot_itr);
+            }
         }
+        std::sort(live.begin(), live.end(), [&](uint16_t a, uint16_t b) {
+            return slot_array[a].offset < slot_array[b].offset;
+        });
 
-        //std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Every record moves to an offset at or below its own, so moving in offset order
+        // never overwrites a record that has yet to move
+        std::vector<uint16_t> moved;
+        size_t offset = metadata_size;
+        for (uint16_t slot : live) {
+            if (slot_array[slot].offset != offset) {
+                std::memmove(page_data.get() + offset, page_data.get() + slot_array[slot].offset, slot_array[slot].length);
+                slot_array[slot].offset = static_cast<uint16_t>(offset);
+                moved.push_back(slot);
+            }
+            offset += slot_array[slot].length;
+        }
+        return moved;
+    }
+
+    const Slot& getSlot(uint16_t slot) const {
+        assert(slot < MAX_SLOTS);
+        return reinterpret_cast<const Slot*>(page_data.get())[slot];
+    }
+
+    // Redo of a logged update: put the record in `slot` at the offset and
+    // length the slot had after the original update
+    void restoreRecord(uint16_t slot, uint16_t offset, uint16_t length, const char* record, size_t size) {
+        assert(slot < MAX_SLOTS && offset >= metadata_size && offset + size < LSN_OFFSET);
+        Slot* slot_array = reinterpret_cast<Slot*>(page_data.get());
+        slot_array[slot].empty = false;
+        slot_array[slot].offset = offset;
+        slot_array[slot].length = length;
+        std::memcpy(page_data.get() + offset, record, size);
+    }
+
+    uint64_t getLsn() const {
+        uint64_t lsn;
+        std::memcpy(&lsn, page_data.get() + LSN_OFFSET, sizeof(lsn));
+        return lsn;
+    }
+
+    void setLsn(uint64_t lsn) {
+        std::memcpy(page_data.get() + LSN_OFFSET, &lsn, sizeof(lsn));
     }
 
     void print() const{
@@ -310,29 +606,103 @@ public:
     }
 };
 
+// Largest record an empty page holds
+static constexpr size_t MAX_RECORD_SIZE = SlottedPage::LSN_OFFSET - sizeof(Slot) * MAX_SLOTS - 1;
+
+using PageID = uint32_t;
+static constexpr PageID INVALID_PAGE_ID = std::numeric_limits<PageID>::max();
+
+// Location of a record: page plus slot within that page
+struct RecordID {
+    PageID page_id = INVALID_PAGE_ID;
+    uint16_t slot_id = INVALID_VALUE;
+};
+
 const std::string database_filename = "buzzdb.dat";
 
+// madvise hint for a read-only snapshot mapping
+enum class AccessAdvice {
+    NORMAL,
+    SEQUENTIAL,
+    RANDOM
+};
+
+// Tag selecting the read-only, memory-mapped open mode
+struct ReadOnlySnapshot {
+    AccessAdvice advice = AccessAdvice::RANDOM;
+};
+
+// Page-granular file I/O through positional pread/pwrite on a file
+// descriptor, so concurrent reads and writes never share a stream cursor.
+// With direct_io the file is opened O_DIRECT (bypassing the page cache,
+// which the buffer pool already is); page buffers are page-aligned for it.
 class StorageManager {
 public:    
-    std::fstream fileStream;
-    size_t num_pages = 0;
+    int fd = -1;
+    bool direct_io = false;
+    std::atomic<size_t> num_pages{0};
+    // Read-only snapshot mode: the whole file mapped PROT_READ
+    bool read_only = false;
+    const char* mapping = nullptr;
+    size_t mapping_size = 0;
+    AccessAdvice advice = AccessAdvice::NORMAL;
+    // Serializes multi-page extension
     std::mutex io_mutex;
 
+private:
+    static void checkIo(ssize_t result, const char* operation) {
+        if (result != static_cast<ssize_t>(PAGE_SIZE)) {
+            std::cerr << "Error: Unable to " << operation << " data "
+                      << (result < 0 ? std::strerror(errno) : "(short transfer)") << "\n";
+            exit(-1);
+        }
+    }
+
 public:
-    StorageManager(bool truncate_mode = true){
-        auto flags =  truncate_mode ? std::ios::in | std::ios::out | std::ios::trunc 
-            : std::ios::in | std::ios::out;
-        fileStream.open(database_filename, flags);
-        if (!fileStream) {
-            // If file does not exist, create it
-            fileStream.clear(); // Reset the state
-            fileStream.open(database_filename, truncate_mode ? (std::ios::out | std::ios::trunc) : std::ios::out);
+    // Move one page between `data` and the file at `offset`, retrying short and interrupted
+    // transfers. Returns the bytes moved (PAGE_SIZE unless it hit the end of the file) or -1.
+    static ssize_t transfer(bool reading, int fd, char* data, uint64_t offset) {
+        size_t done = 0;
+        while (done < PAGE_SIZE) {
+            ssize_t result = reading ? ::pread(fd, data + done, PAGE_SIZE - done, offset + done)
+                                     : ::pwrite(fd, data + done, PAGE_SIZE - done, offset + done);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                return result < 0 ? result : static_cast<ssize_t>(done);
+            }
+            done += static_cast<size_t>(result);
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    StorageManager(bool truncate_mode = true, bool use_direct_io = false){
+        int flags = O_RDWR | O_CREAT | (truncate_mode ? O_TRUNC : 0);
+#ifdef O_DIRECT
+        if (use_direct_io) {
+            fd = ::open(database_filename.c_str(), flags | O_DIRECT, 0644);
+            // Some file systems (e.g. tmpfs) reject O_DIRECT; fall back to buffered I/O
+            direct_io = fd >= 0;
+        }
+#else
+        UNUSED(use_direct_io);
+#endif
+        if (fd < 0) {
+            fd = ::open(database_filename.c_str(), flags, 0644);
+        }
+        if (fd < 0) {
+            std::cerr << "Error: Unable to open " << database_filename << ": " << std::strerror(errno) << "\n";
+            exit(-1);
         }
-        fileStream.close(); 
-        fileStream.open(database_filename, std::ios::in | std::ios::out); 
 
-        fileStream.seekg(0, std::ios::end);
-        num_pages = fileStream.tellg() / PAGE_SIZE;
+        struct stat file_stat;
+        if (::fstat(fd, &file_stat) != 0) {
+            std::string error = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("Unable to stat " + database_filename + ": " + error);
+        }
+        num_pages = static_cast<size_t>(file_stat.st_size) / PAGE_SIZE;
 
         if(num_pages == 0){
             extend();
@@ -340,876 +710,7389 @@ public:
 
     }
 
+    // Open the existing file read-only and map it; pages are then read
+    // straight from the mapping and the OS manages residency
+    explicit StorageManager(ReadOnlySnapshot snapshot) : read_only(true) {
+        fd = ::open(database_filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Error: Unable to open " << database_filename << ": " << std::strerror(errno) << "\n";
+            exit(-1);
+        }
+
+        struct stat file_stat;
+        if (::fstat(fd, &file_stat) != 0) {
+            std::string error = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("Unable to stat " + database_filename + ": " + error);
+        }
+        num_pages = static_cast<size_t>(file_stat.st_size) / PAGE_SIZE;
+        mapping_size = num_pages * PAGE_SIZE;
+        if (mapping_size > 0) {
+            void* address = ::mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (address == MAP_FAILED) {
+                std::cerr << "Error: Unable to map " << database_filename << ": " << std::strerror(errno) << "\n";
+                exit(-1);
+            }
+            mapping = static_cast<const char*>(address);
+            advise(snapshot.advice);
+        }
+    }
+
     ~StorageManager() {
-        if (fileStream.is_open()) {
-            fileStream.close();
+        if (mapping != nullptr) {
+            ::munmap(const_cast<char*>(mapping), mapping_size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
         }
     }
 
-    // Read a page from disk
-    std::unique_ptr<SlottedPage> load(uint16_t page_id) {
-        fileStream.seekg(page_id * PAGE_SIZE, std::ios::beg);
-        auto page = std::make_unique<SlottedPage>();
-        // Read the content of the file into the page
-        if(fileStream.read(page->page_data.get(), PAGE_SIZE)){
-            //std::cout << "Page read successfully from file." << std::endl;
+    bool isReadOnly() const {
+        return read_only;
+    }
+
+    const char* mappedPage(PageID page_id) const {
+        assert(mapping != nullptr && page_id < num_pages);
+        return mapping + static_cast<uint64_t>(page_id) * PAGE_SIZE;
+    }
+
+    // Access-pattern hint for the whole mapping
+    void advise(AccessAdvice new_advice) {
+        if (mapping == nullptr) {
+            return;
         }
-        else{
-            std::cerr << "Error: Unable to read data from the file. \n";
-            exit(-1);
+        advice = new_advice;
+        int hint = advice == AccessAdvice::SEQUENTIAL ? MADV_SEQUENTIAL
+                 : advice == AccessAdvice::RANDOM ? MADV_RANDOM : MADV_NORMAL;
+        ::madvise(const_cast<char*>(mapping), mapping_size, hint);
+    }
+
+    // Ask the OS to start reading a mapped page in the background
+    void willNeed(PageID page_id) {
+        if (mapping != nullptr && page_id < num_pages) {
+            ::madvise(const_cast<char*>(mappedPage(page_id)), PAGE_SIZE, MADV_WILLNEED);
         }
-        return page;
     }
 
-    // Write a page to disk
-    void flush(uint16_t page_id, const SlottedPage& page) {
-        size_t page_offset = page_id * PAGE_SIZE;        
+    // Read a page from disk into an existing buffer
+    void read(PageID page_id, SlottedPage& page) {
+        checkIo(transfer(true, fd, page.page_data.get(), static_cast<uint64_t>(page_id) * PAGE_SIZE), "read");
+    }
 
-        // Move the write pointer
-        fileStream.seekp(page_offset, std::ios::beg);
-        fileStream.write(page.page_data.get(), PAGE_SIZE);        
-        fileStream.flush();
+    // Read a page from disk
+    std::unique_ptr<SlottedPage> load(PageID page_id) {
+        auto page = std::make_unique<SlottedPage>();
+        // Read the content of the file into the page
+        read(page_id, *page);
+        return page;
     }
 
-    // Extend database file by one page
-    void extend() {
-        // Create a slotted page
-        auto empty_slotted_page = std::make_unique<SlottedPage>();
+    // Write a page to the file; sync() makes it durable
+    void write(PageID page_id, const SlottedPage& page) {
+        checkIo(transfer(false, fd, page.page_data.get(), static_cast<uint64_t>(page_id) * PAGE_SIZE), "write");
+    }
 
-        // Move the write pointer
-        fileStream.seekp(0, std::ios::end);
+    // Make the pages written so far durable; throws if the sync fails
+    void sync() {
+        if (::fdatasync(fd) != 0) {
+            throw std::runtime_error("Unable to sync " + database_filename + ": " + std::strerror(errno));
+        }
+    }
 
-        // Write the page to the file, extending it
-        fileStream.write(empty_slotted_page->page_data.get(), PAGE_SIZE);
-        fileStream.flush();
+    // Write a page to disk
+    void flush(PageID page_id, const SlottedPage& page) {
+        write(page_id, page);
+        sync();
+    }
 
-        // Update number of pages
-        num_pages += 1;
+    // Extend database file by one page and return the ID of the new page
+    PageID extend() {
+        // Claim the next page ID, then write an empty slotted page there
+        PageID page_id = static_cast<PageID>(num_pages++);
+        SlottedPage empty_slotted_page;
+        write(page_id, empty_slotted_page);
+        return page_id;
     }
 
     void extend(uint64_t till_page_id) {
         std::lock_guard<std::mutex>  io_guard(io_mutex); 
-        uint64_t write_size = std::max(static_cast<uint64_t>(0), till_page_id + 1 - num_pages) * PAGE_SIZE;
-        if(write_size > 0 ) {
-            // std::cout << "Extending database file till page id : "<<till_page_id<<" \n";
-            char* buffer = new char[write_size];
-            std::memset(buffer, 0, write_size);
-
-            fileStream.seekp(0, std::ios::end);
-            fileStream.write(buffer, write_size);
-            fileStream.flush();
-            
-            num_pages = till_page_id+1;
+        while (num_pages <= till_page_id) {
+            extend();
         }
     }
 
 };
 
-using PageID = uint16_t;
+const std::string wal_filename = "buzzdb.wal";
 
-class Policy {
-public:
-    virtual bool touch(PageID page_id) = 0;
-    virtual PageID evict() = 0;
-    virtual ~Policy() = default;
+enum LogRecordType : uint8_t {
+    LOG_PAGE_PUT = 1,    // Record bytes placed in a slot (insert or in-place update)
+    LOG_PAGE_DELETE = 2, // Slot emptied
+    LOG_PAGE_COMPACT = 3 // Records slid together; redone by compacting the page again
 };
 
-void printList(std::string list_name, const std::list<PageID>& myList) {
-        std::cout << list_name << " :: ";
-        for (const PageID& value : myList) {
-            std::cout << value << ' ';
-        }
-        std::cout << '\n';
-}
+// Redo record for one page update. `offset` and `slot_length` are the slot's state after
+// the update, so redo does not depend on how the page chose them.
+struct LogRecordHeader {
+    uint64_t lsn;
+    uint32_t size;     // Payload bytes that follow
+    uint32_t checksum; // Of the header (with this field zero) and payload; detects a torn tail
+    PageID page_id;
+    uint16_t slot;
+    uint16_t offset;
+    uint16_t slot_length;
+    uint8_t type;
+    uint8_t padding = 0;
+};
 
-class LruPolicy : public Policy {
+// Write-ahead log of page updates, appended to buzzdb.wal. Records get increasing LSNs
+// and are buffered in memory; flush(lsn) makes them durable with group commit: the first
+// waiter writes and syncs everything buffered so far while later callers wait for it, so
+// concurrent commits share one fdatasync. The file starts with the first LSN it holds,
+// which keeps LSNs increasing across checkpoints that empty the file.
+class WriteAheadLog {
 private:
-    // List to keep track of the order of use
-    std::list<PageID> lruList;
+    int fd = -1;
+    mutable std::mutex mutex;
+    std::condition_variable flushed_cv;
+    std::string buffer;       // Appended records not yet written
+    uint64_t next_lsn = 1;
+    uint64_t flushed_lsn = 0; // Every record up to this LSN is durable
+    bool flushing = false;    // A thread is writing and syncing a batch
+    uint64_t file_size = 0;
+    uint64_t syncs = 0;
+
+    static uint32_t checksum(const char* data, size_t size, uint32_t hash = 2166136261u) {
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
 
-    std::unordered_map<PageID, std::list<PageID>::iterator> map;
+    void writeAll(const char* data, size_t size, uint64_t offset) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t result = ::pwrite(fd, data + done, size - done, offset + done);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                std::cerr << "Error: Unable to write " << wal_filename << ": " << std::strerror(errno) << "\n";
+                exit(-1);
+            }
+            done += static_cast<size_t>(result);
+        }
+    }
 
-    size_t cacheSize;
+    // Start the file over, holding records from `first_lsn` on
+    void resetFile(uint64_t first_lsn) {
+        if (::ftruncate(fd, 0) != 0) {
+            std::cerr << "Error: Unable to truncate " << wal_filename << ": " << std::strerror(errno) << "\n";
+            exit(-1);
+        }
+        writeAll(reinterpret_cast<const char*>(&first_lsn), sizeof(first_lsn), 0);
+        if (::fdatasync(fd) != 0) {
+            throw std::runtime_error("Unable to sync " + wal_filename + ": " + std::strerror(errno));
+        }
+        file_size = sizeof(first_lsn);
+    }
 
 public:
-
-    LruPolicy(size_t cacheSize) : cacheSize(cacheSize) {}
-
-    bool touch(PageID page_id) override {
-        //printList("LRU", lruList);
-
-        bool found = false;
-        // If page already in the list, remove it
-        if (map.find(page_id) != map.end()) {
-            found = true;
-            lruList.erase(map[page_id]);
-            map.erase(page_id);            
+    explicit WriteAheadLog(bool truncate) {
+        fd = ::open(wal_filename.c_str(), O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+        if (fd < 0) {
+            std::cerr << "Error: Unable to open " << wal_filename << ": " << std::strerror(errno) << "\n";
+            exit(-1);
         }
-
-        // If cache is full, evict
-        if(lruList.size() == cacheSize){
-            evict();
+        struct stat file_stat;
+        if (::fstat(fd, &file_stat) != 0) {
+            std::string error = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("Unable to stat " + wal_filename + ": " + error);
         }
-
-        if(lruList.size() < cacheSize){
-            // Add the page to the front of the list
-            lruList.emplace_front(page_id);
-            map[page_id] = lruList.begin();
+        file_size = static_cast<uint64_t>(file_stat.st_size);
+        if (file_size < sizeof(uint64_t)) {
+            resetFile(1);
         }
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
 
-        return found;
+    ~WriteAheadLog() {
+        ::close(fd);
     }
 
-    PageID evict() override {
-        // Evict the least recently used page
-        PageID evictedPageId = INVALID_VALUE;
-        if(lruList.size() != 0){
-            evictedPageId = lruList.back();
-            map.erase(evictedPageId);
-            lruList.pop_back();
-        }
-        return evictedPageId;
+    // Buffer a record and return its LSN
+    uint64_t append(LogRecordHeader header, const char* payload = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        header.lsn = next_lsn++;
+        header.checksum = 0;
+        header.checksum = checksum(payload, header.size, checksum(reinterpret_cast<const char*>(&header), sizeof(header)));
+        buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        buffer.append(payload, header.size);
+        return header.lsn;
     }
 
-};
+    // Return once every record up to `lsn` is durable. Throws if the log cannot be synced;
+    // the records then count as not durable.
+    void flush(uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (flushed_lsn < lsn) {
+            if (flushing) {
+                flushed_cv.wait(lock);
+                continue;
+            }
+            // Lead a group commit of everything appended so far
+            flushing = true;
+            std::string batch;
+            batch.swap(buffer);
+            uint64_t batch_lsn = next_lsn - 1;
+            uint64_t offset = file_size;
+            file_size += batch.size();
+            lock.unlock();
+
+            writeAll(batch.data(), batch.size(), offset);
+            bool synced = ::fdatasync(fd) == 0;
+            std::string error = synced ? std::string() : std::strerror(errno);
+
+            lock.lock();
+            flushing = false;
+            if (synced) {
+                flushed_lsn = batch_lsn;
+                syncs++;
+            }
+            flushed_cv.notify_all();
+            if (!synced) {
+                throw std::runtime_error("Unable to sync " + wal_filename + ": " + error);
+            }
+        }
+    }
 
-constexpr size_t MAX_PAGES_IN_MEMORY = 10;
+    void flushAll() {
+        flush(lastLsn());
+    }
 
-class BufferManager {
-private:
-    using PageMap = std::unordered_map<PageID, SlottedPage>;
+    uint64_t lastLsn() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return next_lsn - 1;
+    }
 
-    StorageManager storage_manager;
-    PageMap pageMap;
-    std::unique_ptr<Policy> policy;
+    uint64_t flushedLsn() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return flushed_lsn;
+    }
 
-public:
-    BufferManager(bool storage_manager_truncate_mode = true): 
-        storage_manager(storage_manager_truncate_mode),
-        policy(std::make_unique<LruPolicy>(MAX_PAGES_IN_MEMORY)) {
-            storage_manager.extend(MAX_PAGES);
+    // Bytes in the file plus those still buffered
+    uint64_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return file_size + buffer.size();
     }
-    
-    ~BufferManager() {
-        for (auto& pair : pageMap) {
-            flushPage(pair.first);
-        }
+
+    uint64_t getNumSyncs() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return syncs;
     }
 
-    SlottedPage& fix_page(int page_id) {
-        auto it = pageMap.find(page_id);
-        if (it != pageMap.end()) {
-            policy->touch(page_id);
-            return pageMap.find(page_id)->second;
+    // Calls fn(header, payload) for every intact record in the file, in LSN order, and
+    // continues numbering after the last one. Stops at the first torn or partial record.
+    template <typename Fn>
+    void replay(Fn&& fn) {
+        std::string contents(file_size, '\0');
+        size_t size = 0;
+        while (size < file_size) {
+            ssize_t result = ::pread(fd, contents.data() + size, file_size - size, size);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                throw std::runtime_error("Unable to read " + wal_filename + ": " +
+                                         (result < 0 ? std::strerror(errno) : "file ended early"));
+            }
+            size += static_cast<size_t>(result);
         }
-
-        if (pageMap.size() >= MAX_PAGES_IN_MEMORY) {
-            auto evictedPageId = policy->evict();
-            if(evictedPageId != INVALID_VALUE){
-                // std::cout << "Evicting page " << evictedPageId << "\n";
-                storage_manager.flush(evictedPageId, 
-                                      pageMap[evictedPageId]);
+        if (size < sizeof(uint64_t)) {
+            return;
+        }
+        uint64_t first_lsn;
+        std::memcpy(&first_lsn, contents.data(), sizeof(first_lsn));
+        uint64_t last_lsn = first_lsn - 1;
+
+        size_t pos = sizeof(first_lsn);
+        while (pos + sizeof(LogRecordHeader) <= size) {
+            LogRecordHeader header;
+            std::memcpy(&header, contents.data() + pos, sizeof(header));
+            const char* payload = contents.data() + pos + sizeof(header);
+            if (header.lsn != last_lsn + 1 || pos + sizeof(header) + header.size > size) {
+                break;
+            }
+            uint32_t stored = header.checksum;
+            header.checksum = 0;
+            if (checksum(payload, header.size, checksum(reinterpret_cast<const char*>(&header), sizeof(header))) != stored) {
+                break;
+            }
+            last_lsn = header.lsn;
+            {
+                // The record is already durable, so pages it redoes can be evicted
+                // while the replay continues
+                std::lock_guard<std::mutex> lock(mutex);
+                next_lsn = last_lsn + 1;
+                flushed_lsn = last_lsn;
             }
+            fn(header, payload);
+            pos += sizeof(header) + header.size;
         }
 
-        auto page = storage_manager.load(page_id);
-        policy->touch(page_id);
-        // std::cout << "Loading page: " << page_id << "\n";
-        pageMap[page_id] = std::move(*page);
-        return pageMap[page_id];
+        std::lock_guard<std::mutex> lock(mutex);
+        next_lsn = last_lsn + 1;
+        flushed_lsn = last_lsn;
+        file_size = pos;
     }
 
-    void flushPage(int page_id) {
-        storage_manager.flush(page_id, pageMap[page_id]);
+    // Drop every record once the data file reflects all of them up to `lsn`. If records
+    // were appended after `lsn` the log is kept and false returned. LSNs keep counting up.
+    bool truncate(uint64_t lsn) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (next_lsn - 1 != lsn || flushing) {
+            return false;
+        }
+        assert(buffer.empty() && flushed_lsn == lsn);
+        resetFile(next_lsn);
+        return true;
     }
+};
 
-    void extend(){
-        storage_manager.extend();
-    }
-    
-    size_t getNumPages(){
-        return storage_manager.num_pages;
-    }
+constexpr unsigned PREFETCH_QUEUE_DEPTH = 64; // Reads in flight per io_uring instance
+constexpr size_t PREFETCH_IO_THREADS = 4;     // Workers of the thread-pool fallback
 
+// Asynchronous page reads. read() queues a read of one page into a
+// page-aligned buffer, submit() hands queued reads to the I/O backend, and
+// the completion callback runs on a background thread as each read finishes,
+// in whatever order the device completes them.
+class AsyncPageReader {
+public:
+    // (tag passed to read(), whether the full page was read)
+    using Completion = std::function<void(uint64_t, bool)>;
+
+    virtual void read(uint64_t tag, PageID page_id, char* buffer) = 0;
+    virtual void submit() = 0;
+    virtual const char* name() const = 0;
+    // Implementations wait for every queued read to complete
+    virtual ~AsyncPageReader() = default;
 };
 
-struct pair_hash {
-    template <typename T1, typename T2>
-    std::size_t operator()(const std::pair<T1, T2>& pair) const {
-        auto h1 = std::hash<T1>{}(pair.first);
-        auto h2 = std::hash<T2>{}(pair.second);
-        return h1 ^ (h2 << 1); // Combine hashes
+// Fallback: each read is a blocking pread on a small worker pool
+class ThreadPoolPageReader : public AsyncPageReader {
+private:
+    struct Request {
+        uint64_t tag;
+        PageID page_id;
+        char* buffer;
+    };
+
+    int fd;
+    Completion on_complete;
+    std::mutex mutex;
+    std::vector<Request> queued;
+    ThreadPool pool; // Declared last so its workers drain before the rest is destroyed
+
+public:
+    ThreadPoolPageReader(int fd, Completion on_complete, size_t num_threads = PREFETCH_IO_THREADS)
+        : fd(fd), on_complete(std::move(on_complete)), pool(num_threads) {}
+
+    void read(uint64_t tag, PageID page_id, char* buffer) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(Request{tag, page_id, buffer});
     }
+
+    void submit() override {
+        std::vector<Request> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batch.swap(queued);
+        }
+        for (const Request& request : batch) {
+            pool.submit([this, request]() {
+                ssize_t result = StorageManager::transfer(true, fd, request.buffer,
+                                                          static_cast<uint64_t>(request.page_id) * PAGE_SIZE);
+                on_complete(request.tag, result == static_cast<ssize_t>(PAGE_SIZE));
+            });
+        }
+    }
+
+    const char* name() const override { return "thread pool"; }
 };
 
-class PropertyValue {
-public:
-    std::variant<int, float, std::string> value;
-    FieldType type;
+#ifdef BUZZDB_HAVE_IO_URING
+// io_uring driven directly through its system calls (no liburing). Reads go
+// into the submission ring; a reaper thread blocks in io_uring_enter for
+// completions and runs the callback.
+class IoUringPageReader : public AsyncPageReader {
+private:
+    static constexpr uint64_t STOP_TAG = std::numeric_limits<uint64_t>::max();
+
+    int ring_fd = -1;
+    int fd;
+    Completion on_complete;
+
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned entries = 0;
+
+    // Submission side; the completion side belongs to the reaper thread
+    std::mutex mutex;
+    std::condition_variable slot_free;
+    unsigned queued = 0;    // In the SQ ring, not yet passed to the kernel
+    unsigned in_flight = 0; // Passed to the kernel, completion not yet reaped
+    std::thread reaper;
+
+    static int enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
 
-    PropertyValue() : value(0), type(INT) {}
+    IoUringPageReader(int fd, Completion on_complete) : fd(fd), on_complete(std::move(on_complete)) {}
 
-    PropertyValue(int intValue) : value(intValue), type(INT) {}
-    PropertyValue(float floatValue) : value(floatValue), type(FLOAT) {}
-    PropertyValue(const std::string& stringValue) : value(stringValue), type(STRING) {}
+    bool setup(unsigned depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+        if (ring_fd < 0) {
+            return false;
+        }
 
-    void print() const {
-        switch (type) {
-            case INT:
-                std::cout << std::get<int>(value);
-                break;
-            case FLOAT:
-                std::cout << std::get<float>(value);
-                break;
-            case STRING:
-                std::cout << std::get<std::string>(value);
-                break;
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
         }
-    }
 
-    // Equality operator
-    bool operator==(const PropertyValue& other) const {
-        if (type != other.type) {
+        sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) {
+            sq_ring = nullptr;
             return false;
         }
-        switch (type) {
-            case INT:
-                return std::get<int>(value) == std::get<int>(other.value);
-            case FLOAT:
-                return std::get<float>(value) == std::get<float>(other.value);
-            case STRING:
-                return std::get<std::string>(value) == std::get<std::string>(other.value);
+        cq_ring = single_mmap ? sq_ring
+                              : ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                       ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            cq_ring = nullptr;
+            return false;
         }
-        return false;
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_memory = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring_fd, IORING_OFF_SQES);
+        if (sqe_memory == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqe_memory);
+
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        entries = params.sq_entries;
+
+        reaper = std::thread(&IoUringPageReader::reap, this);
+        return true;
     }
 
-    // Less-than operator for comparisons
-    bool operator<(const PropertyValue& other) const {
-        if (type != other.type) {
-            return type < other.type; // Compare types if they differ
+    // Queue one SQE; called with the mutex held
+    void push(std::unique_lock<std::mutex>& lock, uint8_t opcode, uint64_t tag, PageID page_id, char* buffer) {
+        // Never have more requests outstanding than the rings hold
+        while (queued + in_flight >= entries) {
+            submitQueued();
+            slot_free.wait(lock);
         }
-        switch (type) {
-            case INT:
-                return std::get<int>(value) < std::get<int>(other.value);
-            case FLOAT:
-                return std::get<float>(value) < std::get<float>(other.value);
-            case STRING:
-                return std::get<std::string>(value) < std::get<std::string>(other.value);
+        unsigned tail = *sq_tail;
+        unsigned index = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = opcode == IORING_OP_NOP ? -1 : fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = opcode == IORING_OP_NOP ? 0 : PAGE_SIZE;
+        sqe.off = static_cast<uint64_t>(page_id) * PAGE_SIZE;
+        sqe.user_data = tag;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        queued++;
+    }
+
+    // Hand queued SQEs to the kernel; called with the mutex held
+    void submitQueued() {
+        while (queued > 0) {
+            int submitted = enter(ring_fd, queued, 0, 0);
+            if (submitted < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                std::cerr << "Error: io_uring submission failed: " << std::strerror(errno) << "\n";
+                exit(-1);
+            }
+            queued -= static_cast<unsigned>(submitted);
+            in_flight += static_cast<unsigned>(submitted);
         }
-        return false;
     }
 
-    // Getter for integer value
-    int asInt() const {
-        if (type != INT) {
-            throw std::bad_variant_access();
+    void reap() {
+        bool stopping = false;
+        while (true) {
+            unsigned head = *cq_head;
+            unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                if (stopping) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (in_flight == 0 && queued == 0) {
+                        return;
+                    }
+                }
+                enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+                continue;
+            }
+
+            unsigned reaped = 0;
+            for (; head != tail; ++head, ++reaped) {
+                const io_uring_cqe& cqe = cqes[head & *cq_mask];
+                if (cqe.user_data == STOP_TAG) {
+                    stopping = true;
+                } else {
+                    on_complete(cqe.user_data, cqe.res == static_cast<int32_t>(PAGE_SIZE));
+                }
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            in_flight -= reaped;
+            slot_free.notify_all();
         }
-        return std::get<int>(value);
     }
 
-    // Getter for float value
-    float asFloat() const {
-        if (type != FLOAT) {
-            throw std::bad_variant_access();
+public:
+    // Returns nullptr if the kernel (or a sandbox) does not allow io_uring
+    static std::unique_ptr<IoUringPageReader> create(int fd, Completion on_complete,
+                                                     unsigned depth = PREFETCH_QUEUE_DEPTH) {
+        std::unique_ptr<IoUringPageReader> reader(new IoUringPageReader(fd, std::move(on_complete)));
+        if (!reader->setup(depth)) {
+            return nullptr;
         }
-        return std::get<float>(value);
+        return reader;
     }
 
-    // Getter for string value
-    std::string asString() const {
-        if (type != STRING) {
-            throw std::bad_variant_access();
+    ~IoUringPageReader() override {
+        if (reaper.joinable()) {
+            // A NOP tagged STOP_TAG wakes the reaper, which exits once all reads are reaped
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                push(lock, IORING_OP_NOP, STOP_TAG, 0, nullptr);
+                submitQueued();
+            }
+            reaper.join();
+        }
+        if (sqes != nullptr) {
+            ::munmap(sqes, sqes_size);
+        }
+        if (cq_ring != nullptr && cq_ring != sq_ring) {
+            ::munmap(cq_ring, cq_ring_size);
+        }
+        if (sq_ring != nullptr) {
+            ::munmap(sq_ring, sq_ring_size);
+        }
+        if (ring_fd >= 0) {
+            ::close(ring_fd);
         }
-        return std::get<std::string>(value);
     }
-};
 
-// Class representing a node in the graph
-constexpr size_t MaxPropertyCount = 10;
+    void read(uint64_t tag, PageID page_id, char* buffer) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        push(lock, IORING_OP_READ, tag, page_id, buffer);
+    }
 
-class Node {
-public:
-    uint32_t id; // Node ID
-    std::unordered_map<std::string, PropertyValue> properties; // Properties
-    size_t property_count = 0; // Current number of properties
+    void submit() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        submitQueued();
+    }
 
-    // Constructor
-    Node(uint32_t id) : id(id) {}
+    const char* name() const override { return "io_uring"; }
+};
+#endif
 
-    // Add a property to the node
-    void addProperty(const std::string& name, const PropertyValue& value) {
-        if (property_count >= MaxPropertyCount) {
-            throw std::overflow_error("Maximum property count reached");
-        }
-        properties[name] = value;
-        property_count++;
+// io_uring when available, otherwise the thread-pool fallback
+std::unique_ptr<AsyncPageReader> makePageReader(int fd, AsyncPageReader::Completion on_complete) {
+#ifdef BUZZDB_HAVE_IO_URING
+    if (auto reader = IoUringPageReader::create(fd, on_complete)) {
+        return reader;
     }
+#endif
+    return std::make_unique<ThreadPoolPageReader>(fd, std::move(on_complete));
+}
 
-    // Get a property value by name
-    std::optional<PropertyValue> getProperty(const std::string& name) const {
-        auto it = properties.find(name);
-        if (it != properties.end()) {
-            return it->second;
+// Callback telling a policy whether a page may be evicted (i.e. is unpinned)
+using EvictablePredicate = std::function<bool(PageID)>;
+
+class Policy {
+public:
+    // Record an access; returns true if the page was already tracked
+    virtual bool touch(PageID page_id) = 0;
+    // Choose a victim among evictable pages and stop tracking it,
+    // INVALID_PAGE_ID if there is none
+    virtual PageID evict(const EvictablePredicate& evictable) = 0;
+    virtual ~Policy() = default;
+};
+
+void printList(std::string list_name, const std::list<PageID>& myList) {
+        std::cout << list_name << " :: ";
+        for (const PageID& value : myList) {
+            std::cout << value << ' ';
         }
-        return std::nullopt; // Property not found
-    }
+        std::cout << '\n';
+}
 
-    bool removeProperty(const std::string& name) {
-        auto it = properties.find(name);
-        if (it != properties.end()) {
-            properties.erase(it);
-            property_count--;
+class LruPolicy : public Policy {
+private:
+    // List to keep track of the order of use
+    std::list<PageID> lruList;
+
+    std::unordered_map<PageID, std::list<PageID>::iterator> map;
+
+    size_t cacheSize;
+
+public:
+
+    LruPolicy(size_t cacheSize) : cacheSize(cacheSize) {}
+
+    bool touch(PageID page_id) override {
+        //printList("LRU", lruList);
+
+        // If page already in the list, move it to the front without reallocating
+        auto it = map.find(page_id);
+        if (it != map.end()) {
+            lruList.splice(lruList.begin(), lruList, it->second);
             return true;
         }
+
+        // The buffer manager evicts before touching a new page, since only
+        // it knows which frames are pinned
+        assert(lruList.size() < cacheSize);
+        UNUSED(cacheSize);
+
+        // Add the page to the front of the list
+        lruList.emplace_front(page_id);
+        map[page_id] = lruList.begin();
+
         return false;
     }
 
-    // Print the node's details
-    void print() const {
-        std::cout << "Node " << id << " [ ";
-        for (const auto& [key, value] : properties) {
-            std::cout << key << ": ";
-            value.print();
-            std::cout << ", ";
+    PageID evict(const EvictablePredicate& evictable) override {
+        // Evict the least recently used page that is not pinned
+        for (auto it = lruList.rbegin(); it != lruList.rend(); ++it) {
+            if (evictable(*it)) {
+                PageID evictedPageId = *it;
+                map.erase(evictedPageId);
+                lruList.erase(std::next(it).base());
+                return evictedPageId;
+            }
         }
-        std::cout << "]\n";
+        return INVALID_PAGE_ID;
     }
+
 };
 
-class SNode {
-public:
-    uint32_t id; // Node ID
-    std::array<std::string, MaxPropertyCount> property_names; // Property names (keys)
-    std::array<PropertyValue, MaxPropertyCount> property_values; // Property values
-    size_t property_count = 0; // Current number of properties
+// Second-chance replacement over a fixed array with one entry per frame.
+// Touching only sets a reference bit, so hits do no allocation or list work.
+class ClockPolicy : public Policy {
+private:
+    struct Entry {
+        PageID page_id = INVALID_PAGE_ID;
+        bool referenced = false;
+    };
 
-    // Constructor
-    SNode(uint32_t id) : id(id) {}
+    std::vector<Entry> entries;
+    std::unordered_map<PageID, size_t> slots; // Page ID -> entry index
+    std::vector<size_t> free_slots;
+    size_t hand = 0;
 
-    // Add a property to the node
-    void addProperty(const std::string& name, const PropertyValue& value) {
-        if (property_count >= MaxPropertyCount) {
-            throw std::overflow_error("Maximum property count reached");
+public:
+    ClockPolicy(size_t cacheSize) : entries(cacheSize) {
+        for (size_t slot = cacheSize; slot > 0; --slot) {
+            free_slots.push_back(slot - 1);
         }
-        property_names[property_count] = name;
-        property_values[property_count] = value;
-        property_count++;
     }
 
-    // Print the node's details
-    Node convert() const {
-        Node node(id); // Create a Node object with the same ID
-        for (size_t i = 0; i < property_count; ++i) {
-            node.addProperty(property_names[i], PropertyValue(property_values[i]));
+    bool touch(PageID page_id) override {
+        auto it = slots.find(page_id);
+        if (it != slots.end()) {
+            entries[it->second].referenced = true;
+            return true;
         }
-        return node;
+
+        assert(!free_slots.empty());
+        size_t slot = free_slots.back();
+        free_slots.pop_back();
+        entries[slot] = Entry{page_id, true};
+        slots[page_id] = slot;
+        return false;
     }
 
-    void print() const {
-        std::cout << "Node " << id << " [ ";
-        for (size_t i = 0; i < property_count; ++i) {
-            std::cout << property_names[i] << ": ";
-            property_values[i].print();
-            std::cout << ", ";
+    PageID evict(const EvictablePredicate& evictable) override {
+        // Two sweeps suffice: the first may only clear reference bits
+        for (size_t step = 0; step < 2 * entries.size(); ++step) {
+            size_t slot = hand;
+            hand = (hand + 1) % entries.size();
+
+            Entry& entry = entries[slot];
+            if (entry.page_id == INVALID_PAGE_ID || !evictable(entry.page_id)) {
+                continue;
+            }
+            if (entry.referenced) {
+                entry.referenced = false;
+                continue;
+            }
+
+            PageID victim = entry.page_id;
+            slots.erase(victim);
+            entry = Entry{};
+            free_slots.push_back(slot);
+            return victim;
         }
-        std::cout << "]\n";
+        return INVALID_PAGE_ID;
     }
 };
 
-// Class representing an edge in the graph
-class Edge {
-public:
-    uint32_t id;
-    uint32_t source;
-    uint32_t target;
-    std::unordered_map<std::string, PropertyValue> properties;
-    size_t property_count = 0;
+// 2Q (Johnson & Shasha): first-time pages enter a FIFO (A1in) and only move
+// to the main LRU queue (Am) if they are referenced again after eviction,
+// which the ghost queue A1out remembers. A scan therefore only churns A1in.
+class TwoQPolicy : public Policy {
+private:
+    enum class Queue : uint8_t { A1IN, A1OUT, AM };
+
+    struct Location {
+        Queue queue;
+        std::list<PageID>::iterator position;
+    };
+
+    std::list<PageID> a1in;  // Resident, referenced once; front is newest
+    std::list<PageID> a1out; // Not resident, recently evicted from A1in
+    std::list<PageID> am;    // Resident, hot; front is most recently used
+    std::unordered_map<PageID, Location> map;
+    size_t kin;  // Preferred A1in size
+    size_t kout; // Ghost entries to remember
+
+    // Evict the oldest evictable page of a queue, if any
+    PageID evictFrom(std::list<PageID>& queue, bool remember, const EvictablePredicate& evictable) {
+        for (auto it = queue.rbegin(); it != queue.rend(); ++it) {
+            if (!evictable(*it)) {
+                continue;
+            }
+            PageID victim = *it;
+            queue.erase(std::next(it).base());
+            if (remember) {
+                a1out.push_front(victim);
+                map[victim] = Location{Queue::A1OUT, a1out.begin()};
+                if (a1out.size() > kout) {
+                    map.erase(a1out.back());
+                    a1out.pop_back();
+                }
+            } else {
+                map.erase(victim);
+            }
+            return victim;
+        }
+        return INVALID_PAGE_ID;
+    }
 
-    Edge(uint32_t id, uint32_t source, uint32_t target) : id(id), source(source), target(target) {}
+public:
+    TwoQPolicy(size_t cacheSize)
+        : kin(std::max<size_t>(1, cacheSize / 4)),
+          kout(std::max<size_t>(1, cacheSize / 2)) {}
 
-    void addProperty(const std::string& name, const PropertyValue& value) {
-        if (property_count >= MaxPropertyCount) {
-            throw std::overflow_error("Maximum property count reached");
+    bool touch(PageID page_id) override {
+        auto it = map.find(page_id);
+        if (it == map.end()) {
+            a1in.push_front(page_id);
+            map[page_id] = Location{Queue::A1IN, a1in.begin()};
+            return false;
         }
-        properties[name] = value;
-        property_count++;
-    }
 
-    std::optional<PropertyValue> getProperty(const std::string& name) const {
-        auto it = properties.find(name);
-        if (it != properties.end()) {
-            return it->second;
+        Location& location = it->second;
+        switch (location.queue) {
+            case Queue::AM:
+                am.splice(am.begin(), am, location.position);
+                return true;
+            case Queue::A1IN:
+                // Correlated references while in A1in do not make a page hot
+                return true;
+            case Queue::A1OUT:
+                a1out.erase(location.position);
+                am.push_front(page_id);
+                location = Location{Queue::AM, am.begin()};
+                return false;
         }
-        return std::nullopt;
+        return false;
     }
 
-    bool removeProperty(const std::string& name) {
-        auto it = properties.find(name);
-        if (it != properties.end()) {
-            properties.erase(it);
-            property_count--;
-            return true;
+    PageID evict(const EvictablePredicate& evictable) override {
+        // Prefer A1in while it is over its target size, but fall back to the
+        // other queue when every page in the preferred one is pinned
+        PageID victim;
+        if (a1in.size() > kin || am.empty()) {
+            victim = evictFrom(a1in, true, evictable);
+            if (victim == INVALID_PAGE_ID) {
+                victim = evictFrom(am, false, evictable);
+            }
+        } else {
+            victim = evictFrom(am, false, evictable);
+            if (victim == INVALID_PAGE_ID) {
+                victim = evictFrom(a1in, true, evictable);
+            }
         }
-        return false;
+        return victim;
     }
+};
 
-    void print() const {
+// LRU-K (O'Neil et al.): evict the page whose K-th most recent reference is
+// oldest. Pages seen fewer than K times count as infinitely old and go first,
+// oldest last reference first, so one-off scan pages never displace hot ones.
+// The history of recently evicted pages is retained so a hot page that was
+// pushed out once is recognized when it comes back.
+class LruKPolicy : public Policy {
+private:
+    using History = std::vector<uint64_t>; // Last K reference times, most recent first, 0 if none
+
+    size_t k;
+    size_t retained_limit;
+    uint64_t clock = 0;
+    std::unordered_map<PageID, History> history; // Resident pages
+    std::list<PageID> retained_order;           // Evicted pages, oldest eviction first
+    std::unordered_map<PageID, std::pair<History, std::list<PageID>::iterator>> retained;
+
+public:
+    LruKPolicy(size_t cacheSize, size_t k = 2) : k(k), retained_limit(cacheSize) {
+        assert(k > 0);
+    }
+
+    bool touch(PageID page_id) override {
+        auto [it, inserted] = history.try_emplace(page_id, k, 0);
+        History& times = it->second;
+        if (inserted) {
+            auto old = retained.find(page_id);
+            if (old != retained.end()) {
+                times = std::move(old->second.first);
+                retained_order.erase(old->second.second);
+                retained.erase(old);
+            }
+        }
+        std::copy_backward(times.begin(), times.end() - 1, times.end());
+        times[0] = ++clock;
+        return !inserted;
+    }
+
+    PageID evict(const EvictablePredicate& evictable) override {
+        auto victim = history.end();
+        for (auto it = history.begin(); it != history.end(); ++it) {
+            if (!evictable(it->first)) {
+                continue;
+            }
+            if (victim == history.end()) {
+                victim = it;
+                continue;
+            }
+            const History& times = it->second;
+            const History& best = victim->second;
+            if (std::make_pair(times[k - 1], times[0]) < std::make_pair(best[k - 1], best[0])) {
+                victim = it;
+            }
+        }
+        if (victim == history.end()) {
+            return INVALID_PAGE_ID;
+        }
+
+        PageID page_id = victim->first;
+        retained_order.push_back(page_id);
+        retained[page_id] = {std::move(victim->second), std::prev(retained_order.end())};
+        history.erase(victim);
+
+        // Forget the history of the page evicted longest ago
+        if (retained.size() > retained_limit) {
+            retained.erase(retained_order.front());
+            retained_order.pop_front();
+        }
+        return page_id;
+    }
+};
+
+enum class ReplacementPolicy {
+    LRU,
+    CLOCK,
+    TWO_Q,
+    LRU_K
+};
+
+std::unique_ptr<Policy> makePolicy(ReplacementPolicy kind, size_t cacheSize) {
+    switch (kind) {
+        case ReplacementPolicy::CLOCK:
+            return std::make_unique<ClockPolicy>(cacheSize);
+        case ReplacementPolicy::TWO_Q:
+            return std::make_unique<TwoQPolicy>(cacheSize);
+        case ReplacementPolicy::LRU_K:
+            return std::make_unique<LruKPolicy>(cacheSize, 2);
+        case ReplacementPolicy::LRU:
+        default:
+            return std::make_unique<LruPolicy>(cacheSize);
+    }
+}
+
+constexpr size_t MAX_PAGES_IN_MEMORY = 10;
+constexpr std::chrono::milliseconds FLUSH_INTERVAL(100); // Background flusher period
+constexpr uint64_t CHECKPOINT_LOG_BYTES = 16 << 20; // Log size at which the flusher checkpoints
+constexpr std::chrono::milliseconds PIN_WAIT_TIMEOUT(50); // How long a miss waits for a frame to be unpinned
+
+// One slot of the buffer pool. The latch protects the page contents; the
+// page ID, pin count and loading flag are protected by the buffer manager's
+// pool mutex. The dirty bit is set by writers and cleared by whoever writes
+// the page back.
+struct BufferFrame {
+    PageID page_id = INVALID_PAGE_ID;
+    std::unique_ptr<SlottedPage> page = std::make_unique<SlottedPage>();
+    std::shared_mutex latch;
+    size_t pin_count = 0;
+    bool loading = false; // A read into `page` is in progress
+    std::atomic<bool> dirty{false};
+};
+
+// Buffer pool counters for comparing replacement policies
+struct BufferStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t writes = 0; // Pages written back to the file
+    uint64_t prefetches = 0; // Asynchronous reads issued by prefetch()
+
+    double hitRatio() const {
+        uint64_t accesses = hits + misses;
+        return accesses == 0 ? 0.0 : static_cast<double>(hits) / accesses;
+    }
+};
+
+class BufferManager;
+
+// Keeps a page pinned and latched (shared or exclusive) until it goes out
+// of scope, so the frame cannot be evicted while the page is in use. In
+// snapshot mode it is a plain view of a mapped page and holds nothing.
+class PageGuard {
+private:
+    BufferManager* buffer_manager = nullptr;
+    BufferFrame* frame = nullptr;
+    SlottedPage* page = nullptr;
+    PageID page_id = INVALID_PAGE_ID;
+    bool exclusive = false;
+
+public:
+    PageGuard() = default;
+
+    PageGuard(BufferManager* buffer_manager, BufferFrame* frame, bool exclusive)
+        : buffer_manager(buffer_manager), frame(frame), page(frame->page.get()),
+          page_id(frame->page_id), exclusive(exclusive) {}
+
+    // View of a page in a read-only mapping
+    PageGuard(SlottedPage* mapped_page, PageID page_id)
+        : page(mapped_page), page_id(page_id) {}
+
+    PageGuard(const PageGuard&) = delete;
+    PageGuard& operator=(const PageGuard&) = delete;
+
+    PageGuard(PageGuard&& other) noexcept
+        : buffer_manager(other.buffer_manager), frame(other.frame), page(other.page),
+          page_id(other.page_id), exclusive(other.exclusive) {
+        other.frame = nullptr;
+        other.page = nullptr;
+    }
+
+    PageGuard& operator=(PageGuard&& other) noexcept {
+        if (this != &other) {
+            release();
+            buffer_manager = other.buffer_manager;
+            frame = other.frame;
+            page = other.page;
+            page_id = other.page_id;
+            exclusive = other.exclusive;
+            other.frame = nullptr;
+            other.page = nullptr;
+        }
+        return *this;
+    }
+
+    ~PageGuard() { release(); }
+
+    // Unlatch and unpin the page early
+    void release();
+
+    // Record that the page was modified so it is written back before its
+    // frame is reused. Requires an exclusive guard.
+    void markDirty();
+
+    // Logged counterparts of the SlottedPage operations: apply the change,
+    // append a redo record to the write-ahead log, stamp the page with its
+    // LSN and mark it dirty. Require an exclusive guard. addRecord and
+    // updateRecord compact the page when that makes the record fit, logging
+    // the compaction as one record that redo repeats.
+    std::optional<uint16_t> addRecord(const char* record, size_t size);
+    bool updateRecord(uint16_t slot, const char* record, size_t size);
+    void deleteRecord(uint16_t slot);
+
+private:
+    void compact();
+
+public:
+
+    PageID pageId() const { return page_id; }
+    bool isExclusive() const { return exclusive; }
+
+    SlottedPage& operator*() const { return *page; }
+    SlottedPage* operator->() const { return page; }
+};
+
+class BufferManager {
+private:
+    StorageManager storage_manager;
+    std::unique_ptr<Policy> policy;
+
+    // Fixed frame array plus the page table mapping resident pages to frames
+    std::vector<BufferFrame> frames;
+    std::unordered_map<PageID, size_t> page_table;
+    std::vector<size_t> free_frames;
+    std::mutex pool_mutex;
+    BufferStats stats; // Protected by the pool mutex
+    std::condition_variable frame_unpinned;
+    size_t frame_waiters = 0; // Protected by the pool mutex
+    std::condition_variable frame_loaded;
+    size_t load_waiters = 0; // Protected by the pool mutex
+
+    // Background writer for dirty pages, woken early once half the pool is
+    // dirty so eviction mostly finds clean victims
+    std::atomic<size_t> dirty_pages{0};
+    size_t dirty_threshold;
+    // Held by flushPage and flushDirtyPages, so a sync after one of them covers every
+    // write-back that another thread had started
+    std::mutex write_back_mutex;
+
+    // Backend for prefetch(); completions arrive on its own thread
+    std::unique_ptr<AsyncPageReader> page_reader;
+
+    // Snapshot mode: one view per page of the mapped file
+    std::vector<SlottedPage> mapped_pages;
+
+    // Redo log of page updates; none in snapshot mode. A dirty page is only
+    // written once the log is durable up to the page's LSN.
+    std::unique_ptr<WriteAheadLog> wal;
+    size_t recovered_records = 0;
+    std::thread flusher;
+    std::condition_variable flusher_cv;
+    bool stop_flusher = false; // Protected by the pool mutex
+    // wakeFlusher() requests and the ones the flusher has answered, protected by the pool mutex
+    uint64_t flush_requests = 0;
+    uint64_t answered_flush_requests = 0;
+    std::condition_variable flush_answered_cv;
+    // First I/O error of a background write-back, rethrown to the next commit() or
+    // fix_page() caller; protected by the pool mutex
+    std::exception_ptr flusher_error;
+
+    // Must be called with the pool mutex held
+    void rethrowFlusherError() {
+        if (flusher_error) {
+            std::rethrow_exception(std::exchange(flusher_error, nullptr));
+        }
+    }
+
+    void runFlusher() {
+        std::unique_lock<std::mutex> pool_lock(pool_mutex);
+        while (!stop_flusher) {
+            flusher_cv.wait_for(pool_lock, FLUSH_INTERVAL, [this]() {
+                return stop_flusher || dirty_pages >= dirty_threshold || flush_requests > answered_flush_requests;
+            });
+            if (stop_flusher) {
+                break;
+            }
+            uint64_t requests = flush_requests;
+            bool checkpoint_due = wal->size() >= CHECKPOINT_LOG_BYTES;
+            if (dirty_pages > 0 || checkpoint_due) {
+                pool_lock.unlock();
+                std::exception_ptr error;
+                try {
+                    if (checkpoint_due) {
+                        checkpoint();
+                    } else {
+                        flushDirtyPages();
+                    }
+                } catch (...) {
+                    error = std::current_exception(); // The log is kept; a later pass retries
+                }
+                pool_lock.lock();
+                if (error && !flusher_error) {
+                    flusher_error = error;
+                }
+            }
+            if (requests > answered_flush_requests) {
+                answered_flush_requests = requests;
+                flush_answered_cv.notify_all();
+            }
+        }
+        answered_flush_requests = flush_requests;
+        flush_answered_cv.notify_all();
+    }
+
+    // Find a frame for a new page, writing back a dirty unpinned victim if
+    // the pool is full. Must be called with the pool mutex held, so dirty pages
+    // whose log records are not durable yet are passed over rather than syncing
+    // the log here.
+    std::optional<size_t> allocateFrame() {
+        if (!free_frames.empty()) {
+            size_t frame_index = free_frames.back();
+            free_frames.pop_back();
+            return frame_index;
+        }
+
+        uint64_t durable_lsn = wal->flushedLsn();
+        PageID victim = policy->evict([this, durable_lsn](PageID page_id) {
+            const BufferFrame& frame = frames[page_table.at(page_id)];
+            return frame.pin_count == 0 && !frame.loading && (!frame.dirty || frame.page->getLsn() <= durable_lsn);
+        });
+        if (victim == INVALID_PAGE_ID) {
+            return std::nullopt;
+        }
+
+        size_t frame_index = page_table.at(victim);
+        BufferFrame& frame = frames[frame_index];
+        stats.evictions++;
+        // std::cout << "Evicting page " << victim << "\n";
+        if (frame.dirty.exchange(false)) {
+            dirty_pages--;
+            storage_manager.write(victim, *frame.page);
+            stats.writes++;
+        }
+        page_table.erase(victim);
+        frame.page_id = INVALID_PAGE_ID;
+        return frame_index;
+    }
+
+public:
+    BufferManager(bool storage_manager_truncate_mode = true,
+                  size_t num_frames = MAX_PAGES_IN_MEMORY,
+                  ReplacementPolicy replacement_policy = ReplacementPolicy::LRU,
+                  bool direct_io = false):
+        storage_manager(storage_manager_truncate_mode, direct_io),
+        policy(makePolicy(replacement_policy, num_frames)),
+        frames(num_frames),
+        dirty_threshold(std::max<size_t>(1, num_frames / 2)) {
+        for (size_t frame_index = num_frames; frame_index > 0; --frame_index) {
+            free_frames.push_back(frame_index - 1);
+        }
+        page_reader = makePageReader(storage_manager.fd, [this](uint64_t frame_index, bool ok) {
+            completePrefetch(frames[frame_index], ok);
+        });
+        wal = std::make_unique<WriteAheadLog>(storage_manager_truncate_mode);
+        if (!storage_manager_truncate_mode) {
+            recover();
+        }
+        flusher = std::thread(&BufferManager::runFlusher, this);
+    }
+
+    // Read-only snapshot of the existing file. Pages are served as views into
+    // a mapping of the file: no frames, copies, eviction or write-back, and
+    // any attempt to modify or allocate a page throws std::logic_error.
+    explicit BufferManager(ReadOnlySnapshot snapshot):
+        storage_manager(snapshot),
+        policy(makePolicy(ReplacementPolicy::LRU, 0)),
+        dirty_threshold(1) {
+        mapped_pages.reserve(storage_manager.num_pages);
+        for (PageID page_id = 0; page_id < storage_manager.num_pages; ++page_id) {
+            mapped_pages.emplace_back(storage_manager.mappedPage(page_id));
+        }
+    }
+
+    ~BufferManager() {
+        if (isReadOnly()) {
+            return;
+        }
+        // Wait for outstanding prefetches before anything they touch goes away
+        page_reader.reset();
+        {
+            std::lock_guard<std::mutex> pool_lock(pool_mutex);
+            stop_flusher = true;
+        }
+        flusher_cv.notify_one();
+        flusher.join();
+        // Destructors must not throw; report like the other I/O errors. The log is kept,
+        // so the next open redoes what did not reach the file.
+        try {
+            checkpoint();
+            std::lock_guard<std::mutex> pool_lock(pool_mutex);
+            rethrowFlusherError();
+        } catch (const std::exception& error) {
+            std::cerr << "Error: " << error.what() << "\n";
+        }
+    }
+
+    bool isReadOnly() const {
+        return storage_manager.isReadOnly();
+    }
+
+    // Access-pattern hint; only affects snapshot mappings
+    void adviseAccess(AccessAdvice advice) {
+        storage_manager.advise(advice);
+    }
+
+    AccessAdvice getAccessAdvice() const {
+        return storage_manager.advice;
+    }
+
+    // Pin a page and latch it shared (readers) or exclusive (writers).
+    // Throws std::runtime_error if every frame stays pinned for PIN_WAIT_TIMEOUT,
+    // or with the error of a failed background write-back.
+    // A thread must not fix a page it already holds a guard on, shared or not:
+    // the latch is not recursive.
+    PageGuard fix_page(PageID page_id, bool exclusive = false) {
+        if (isReadOnly()) {
+            if (exclusive) {
+                throw std::logic_error("Cannot modify a page of a read-only snapshot");
+            }
+            if (page_id >= mapped_pages.size()) {
+                throw std::out_of_range("Page ID is beyond the end of the snapshot");
+            }
+            return PageGuard(&mapped_pages[page_id], page_id);
+        }
+
+        std::unique_lock<std::mutex> pool_lock(pool_mutex);
+        rethrowFlusherError();
+        std::optional<size_t> frame_index;
+        while (true) {
+            auto it = page_table.find(page_id);
+            if (it != page_table.end()) {
+                BufferFrame& frame = frames[it->second];
+                frame.pin_count++;
+                policy->touch(page_id);
+                stats.hits++;
+                if (frame.loading) {
+                    // Another fix or a prefetch is reading the page; the pin keeps the frame ours
+                    load_waiters++;
+                    frame_loaded.wait(pool_lock, [&frame]() { return !frame.loading; });
+                    load_waiters--;
+                }
+                pool_lock.unlock();
+
+                if (exclusive) {
+                    frame.latch.lock();
+                } else {
+                    frame.latch.lock_shared();
+                }
+                return PageGuard(this, &frame, exclusive);
+            }
+
+            frame_index = allocateFrame();
+            if (frame_index) {
+                break;
+            }
+            if (wal->flushedLsn() < wal->lastLsn()) {
+                // Unpinned dirty pages may only be waiting for their log records
+                pool_lock.unlock();
+                wal->flushAll();
+                pool_lock.lock();
+                continue;
+            }
+
+            // Other threads (or the flusher) may only hold their pins briefly;
+            // the page may also have been loaded by someone else meanwhile
+            frame_waiters++;
+            auto status = frame_unpinned.wait_for(pool_lock, PIN_WAIT_TIMEOUT);
+            frame_waiters--;
+            if (status == std::cv_status::timeout) {
+                throw std::runtime_error("Buffer pool exhausted: all frames are pinned");
+            }
+        }
+
+        stats.misses++;
+        BufferFrame& frame = frames[*frame_index];
+        frame.page_id = page_id;
+        frame.pin_count = 1;
+        frame.loading = true;
+        page_table[page_id] = *frame_index;
+        policy->touch(page_id);
+        pool_lock.unlock();
+
+        // Concurrent fixes of the same page wait on frame_loaded meanwhile
+        // std::cout << "Loading page: " << page_id << "\n";
+        storage_manager.read(page_id, *frame.page);
+        finishLoad(frame);
+
+        if (exclusive) {
+            frame.latch.lock();
+        } else {
+            frame.latch.lock_shared();
+        }
+        return PageGuard(this, &frame, exclusive);
+    }
+
+    // Start asynchronous reads of the pages in `pages` that are not resident
+    // and return how many were issued. At most half the pool is used per
+    // call so prefetched pages are not evicted again before they are fixed;
+    // frames come from the free list or unpinned victims, never by waiting.
+    // A later fix_page of a prefetched page waits only for its own read.
+    size_t prefetch(std::vector<PageID> pages) {
+        std::sort(pages.begin(), pages.end());
+        pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+        // A snapshot has no frames to fill; let the kernel read ahead instead
+        if (isReadOnly()) {
+            for (PageID page_id : pages) {
+                storage_manager.willNeed(page_id);
+            }
+            return pages.size();
+        }
+
+        std::vector<size_t> issued;
+        {
+            std::lock_guard<std::mutex> pool_lock(pool_mutex);
+            size_t limit = std::max<size_t>(1, frames.size() / 2);
+            for (PageID page_id : pages) {
+                if (issued.size() == limit) {
+                    break;
+                }
+                if (page_id >= storage_manager.num_pages || page_table.count(page_id) != 0) {
+                    continue;
+                }
+                auto frame_index = allocateFrame();
+                if (!frame_index) {
+                    break;
+                }
+                BufferFrame& frame = frames[*frame_index];
+                frame.page_id = page_id;
+                frame.loading = true;
+                page_table[page_id] = *frame_index;
+                policy->touch(page_id);
+                stats.prefetches++;
+                issued.push_back(*frame_index);
+            }
+        }
+
+        for (size_t frame_index : issued) {
+            BufferFrame& frame = frames[frame_index];
+            page_reader->read(frame_index, frame.page_id, frame.page->page_data.get());
+        }
+        page_reader->submit();
+        return issued.size();
+    }
+
+    // Name of the asynchronous read backend in use
+    const char* prefetchBackend() const {
+        return isReadOnly() ? "madvise" : page_reader->name();
+    }
+
+    // Mark a frame's read as finished and wake fixes waiting for it
+    void finishLoad(BufferFrame& frame) {
+        std::lock_guard<std::mutex> pool_lock(pool_mutex);
+        frame.loading = false;
+        if (load_waiters > 0) {
+            frame_loaded.notify_all();
+        }
+    }
+
+    // Runs on the reader's completion thread. A failed or short asynchronous
+    // read is retried synchronously.
+    void completePrefetch(BufferFrame& frame, bool ok) {
+        if (!ok) {
+            storage_manager.read(frame.page_id, *frame.page);
+        }
+        finishLoad(frame);
+    }
+
+    // Called by PageGuard
+    void markDirty(BufferFrame& frame) {
+        if (!frame.dirty.exchange(true)) {
+            if (++dirty_pages >= dirty_threshold) {
+                flusher_cv.notify_one();
+            }
+        }
+    }
+
+    // Called by PageGuard: drop the latch, then the pin
+    void unfix_page(BufferFrame& frame, bool exclusive) {
+        if (exclusive) {
+            frame.latch.unlock();
+        } else {
+            frame.latch.unlock_shared();
+        }
+        std::lock_guard<std::mutex> pool_lock(pool_mutex);
+        assert(frame.pin_count > 0);
+        if (--frame.pin_count == 0 && frame_waiters > 0) {
+            frame_unpinned.notify_all();
+        }
+    }
+
+    // Write a resident page back to disk if it is dirty. Pages that are not
+    // resident were already written when they were evicted. Must not be
+    // called while the calling thread holds an exclusive guard on the page.
+    void flushPage(PageID page_id) {
+        std::lock_guard<std::mutex> write_back_lock(write_back_mutex);
+        std::unique_lock<std::mutex> pool_lock(pool_mutex);
+        auto it = page_table.find(page_id);
+        if (it == page_table.end() || !frames[it->second].dirty) {
+            return;
+        }
+        BufferFrame& frame = frames[it->second];
+        frame.pin_count++;
+        pool_lock.unlock();
+
+        frame.latch.lock_shared();
+        PageGuard guard(this, &frame, false);
+        if (frame.dirty.exchange(false)) {
+            dirty_pages--;
+            wal->flush(frame.page->getLsn());
+            storage_manager.flush(page_id, *frame.page);
+            std::lock_guard<std::mutex> stats_lock(pool_mutex);
+            stats.writes++;
+        }
+    }
+
+    // Write every dirty resident page in page-ID order so the file sees one
+    // ascending sweep, then sync once. Returns the number of pages written.
+    // Pins one page at a time so foreground fixes are not starved of frames.
+    // Must not be called while the calling thread holds an exclusive guard.
+    size_t flushDirtyPages() {
+        std::lock_guard<std::mutex> write_back_lock(write_back_mutex);
+        std::vector<PageID> batch;
+        {
+            std::lock_guard<std::mutex> pool_lock(pool_mutex);
+            for (const auto& entry : page_table) {
+                if (frames[entry.second].dirty) {
+                    batch.push_back(entry.first);
+                }
+            }
+        }
+        std::sort(batch.begin(), batch.end());
+
+        size_t written = 0;
+        for (PageID page_id : batch) {
+            BufferFrame* frame;
+            {
+                std::lock_guard<std::mutex> pool_lock(pool_mutex);
+                auto it = page_table.find(page_id);
+                if (it == page_table.end() || !frames[it->second].dirty) {
+                    continue; // Evicted or written back in the meantime
+                }
+                frame = &frames[it->second];
+                frame->pin_count++;
+            }
+
+            frame->latch.lock_shared();
+            PageGuard guard(this, frame, false);
+            if (frame->dirty.exchange(false)) {
+                dirty_pages--;
+                wal->flush(frame->page->getLsn());
+                storage_manager.write(page_id, *frame->page);
+                written++;
+            }
+        }
+        if (written > 0) {
+            storage_manager.sync();
+            std::lock_guard<std::mutex> pool_lock(pool_mutex);
+            stats.writes += written;
+        }
+        return written;
+    }
+
+    // Called by PageGuard after a logged page update
+    void logUpdate(BufferFrame& frame, LogRecordType type, uint16_t slot,
+                   const char* record = nullptr, size_t size = 0) {
+        LogRecordHeader header{};
+        header.page_id = frame.page_id;
+        header.type = type;
+        header.slot = slot;
+        header.size = static_cast<uint32_t>(size);
+        if (type == LOG_PAGE_PUT) {
+            const Slot& slot_info = frame.page->getSlot(slot);
+            header.offset = slot_info.offset;
+            header.slot_length = slot_info.length;
+        }
+        // Dirty before the record exists, so a checkpoint that covers the record cannot
+        // miss the page
+        markDirty(frame);
+        frame.page->setLsn(wal->append(header, record));
+    }
+
+    // Make every logged update so far durable. Concurrent commits are
+    // batched into one log sync. Also throws the error of a failed background
+    // write-back.
+    void commit() {
+        if (wal) {
+            {
+                std::lock_guard<std::mutex> pool_lock(pool_mutex);
+                rethrowFlusherError();
+            }
+            wal->flushAll();
+        }
+    }
+
+    // Write every dirty page back, make the file durable and empty the log.
+    // Writers may keep going meanwhile; if they log anything, the log is kept
+    // for the next checkpoint.
+    void checkpoint() {
+        if (!wal) {
+            return;
+        }
+        uint64_t lsn = wal->lastLsn();
+        wal->flush(lsn);
+        flushDirtyPages();
+        storage_manager.sync(); // Also covers pages written earlier by eviction
+        wal->truncate(lsn);
+    }
+
+    // Redo the logged updates that did not reach the file before the last
+    // shutdown, then checkpoint. Runs when an existing file is opened.
+    void recover() {
+        wal->replay([this](const LogRecordHeader& header, const char* payload) {
+            storage_manager.extend(header.page_id); // Its allocation may not have reached the file
+            PageGuard page = fix_page(header.page_id, true);
+            if (page->getLsn() >= header.lsn) {
+                return; // Written back after this update
+            }
+            if (header.type == LOG_PAGE_PUT) {
+                page->restoreRecord(header.slot, header.offset, header.slot_length, payload, header.size);
+            } else if (header.type == LOG_PAGE_COMPACT) {
+                page->compact(); // Moves the same records as before, the page being as it was then
+            } else {
+                page->deleteTuple(header.slot);
+            }
+            page->setLsn(header.lsn);
+            page.markDirty();
+            recovered_records++;
+        });
+        checkpoint();
+    }
+
+    // Number of log records redone when the file was opened
+    size_t getNumRecoveredRecords() const {
+        return recovered_records;
+    }
+
+    uint64_t getNumLogSyncs() const {
+        return wal ? wal->getNumSyncs() : 0;
+    }
+
+    void extend(){
+        allocatePage();
+    }
+
+    // Append an empty page to the database file and return its ID
+    PageID allocatePage() {
+        if (isReadOnly()) {
+            throw std::logic_error("Cannot extend a read-only snapshot");
+        }
+        return storage_manager.extend();
+    }
+
+    size_t getNumPages(){
+        return storage_manager.num_pages;
+    }
+
+    size_t getNumFrames() const {
+        return frames.size();
+    }
+
+    size_t getNumDirtyPages() const {
+        return dirty_pages;
+    }
+
+    // Run a background flusher pass now and wait until it is done. The pass starts after
+    // the call, so every page dirtied before it has been written back on return.
+    void wakeFlusher() {
+        std::unique_lock<std::mutex> pool_lock(pool_mutex);
+        uint64_t request = ++flush_requests;
+        flusher_cv.notify_one();
+        flush_answered_cv.wait(pool_lock, [&]() { return answered_flush_requests >= request; });
+    }
+
+    // Whether the file was opened for O_DIRECT I/O (false if unsupported)
+    bool usesDirectIo() const {
+        return storage_manager.direct_io;
+    }
+
+    BufferStats getStats() {
+        std::lock_guard<std::mutex> pool_lock(pool_mutex);
+        return stats;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> pool_lock(pool_mutex);
+        stats = BufferStats{};
+    }
+
+};
+
+inline void PageGuard::release() {
+    if (frame != nullptr) {
+        buffer_manager->unfix_page(*frame, exclusive);
+        frame = nullptr;
+    }
+    page = nullptr;
+}
+
+inline void PageGuard::markDirty() {
+    assert(exclusive && frame != nullptr);
+    buffer_manager->markDirty(*frame);
+}
+
+inline void PageGuard::compact() {
+    if (!page->compact().empty()) {
+        buffer_manager->logUpdate(*frame, LOG_PAGE_COMPACT, 0);
+    }
+}
+
+inline std::optional<uint16_t> PageGuard::addRecord(const char* record, size_t size) {
+    assert(exclusive && frame != nullptr);
+    auto slot = page->addRecord(record, size);
+    if (!slot && page->freeSpace() >= size) {
+        compact();
+        slot = page->addRecord(record, size);
+        assert(slot.has_value());
+    }
+    if (slot) {
+        buffer_manager->logUpdate(*frame, LOG_PAGE_PUT, *slot, record, size);
+    }
+    return slot;
+}
+
+inline bool PageGuard::updateRecord(uint16_t slot, const char* record, size_t size) {
+    assert(exclusive && frame != nullptr);
+    if (!page->updateRecord(slot, record, size)) {
+        if (page->getRecord(slot) == nullptr || page->unusedSpace() + page->getSlot(slot).length < size) {
+            return false;
+        }
+        // Free the old version first: replaying only part of this leaves the record
+        // missing rather than pointing at bytes the compaction reused
+        deleteRecord(slot);
+        compact();
+        [[maybe_unused]] bool stored = page->putRecord(slot, record, size);
+        assert(stored);
+    }
+    buffer_manager->logUpdate(*frame, LOG_PAGE_PUT, slot, record, size);
+    return true;
+}
+
+inline void PageGuard::deleteRecord(uint16_t slot) {
+    assert(exclusive && frame != nullptr);
+    page->deleteTuple(slot);
+    buffer_manager->logUpdate(*frame, LOG_PAGE_DELETE, slot);
+}
+
+struct pair_hash {
+    template <typename T1, typename T2>
+    std::size_t operator()(const std::pair<T1, T2>& pair) const {
+        auto h1 = std::hash<T1>{}(pair.first);
+        auto h2 = std::hash<T2>{}(pair.second);
+        return h1 ^ (h2 << 1); // Combine hashes
+    }
+};
+
+// Append the raw bytes of a trivially copyable value to a record buffer
+template <typename T>
+void appendBytes(std::string& buffer, const T& value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Read a trivially copyable value from a record and advance the cursor
+template <typename T>
+T readBytes(const char*& cursor) {
+    T value;
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+class PropertyValue {
+public:
+    std::variant<int, float, std::string> value;
+    FieldType type;
+
+    PropertyValue() : value(0), type(INT) {}
+
+    PropertyValue(int intValue) : value(intValue), type(INT) {}
+    PropertyValue(float floatValue) : value(floatValue), type(FLOAT) {}
+    PropertyValue(const std::string& stringValue) : value(stringValue), type(STRING) {}
+
+    void print() const {
+        switch (type) {
+            case INT:
+                std::cout << std::get<int>(value);
+                break;
+            case FLOAT:
+                std::cout << std::get<float>(value);
+                break;
+            case STRING:
+                std::cout << std::get<std::string>(value);
+                break;
+        }
+    }
+
+    // Equality operator
+    bool operator==(const PropertyValue& other) const {
+        if (type != other.type) {
+            return false;
+        }
+        switch (type) {
+            case INT:
+                return std::get<int>(value) == std::get<int>(other.value);
+            case FLOAT:
+                return std::get<float>(value) == std::get<float>(other.value);
+            case STRING:
+                return std::get<std::string>(value) == std::get<std::string>(other.value);
+        }
+        return false;
+    }
+
+    // Less-than operator for comparisons
+    bool operator<(const PropertyValue& other) const {
+        if (type != other.type) {
+            return type < other.type; // Compare types if they differ
+        }
+        switch (type) {
+            case INT:
+                return std::get<int>(value) < std::get<int>(other.value);
+            case FLOAT:
+                return std::get<float>(value) < std::get<float>(other.value);
+            case STRING:
+                return std::get<std::string>(value) < std::get<std::string>(other.value);
+        }
+        return false;
+    }
+
+    // Getter for integer value
+    int asInt() const {
+        if (type != INT) {
+            throw std::bad_variant_access();
+        }
+        return std::get<int>(value);
+    }
+
+    // Getter for float value
+    float asFloat() const {
+        if (type != FLOAT) {
+            throw std::bad_variant_access();
+        }
+        return std::get<float>(value);
+    }
+
+    // Getter for string value
+    std::string asString() const {
+        if (type != STRING) {
+            throw std::bad_variant_access();
+        }
+        return std::get<std::string>(value);
+    }
+};
+
+// On-disk record format. Every record starts with a RecordHeader so a page scan can tell
+// nodes, edges and catalog entries apart without any outside metadata.
+enum RecordKind : uint8_t {
+    NODE_RECORD = 1,
+    EDGE_RECORD = 2,
+    KEY_RECORD = 3,    // Property key catalog entry
+    STRING_RECORD = 4, // String dictionary entry
+    META_RECORD = 5,   // Named database-level value, e.g. where the graph was loaded from
+    INDEX_RECORD = 6   // B+-tree node of a property index
+};
+
+// Type byte of a property directory entry. Dictionary strings store their code inline.
+enum StoredType : uint8_t {
+    STORED_INT = INT,
+    STORED_FLOAT = FLOAT,
+    STORED_STRING = STRING,
+    STORED_DICTIONARY_STRING = 3
+};
+
+// Strings up to this length are dictionary-encoded, longer ones (post content) stay inline
+static constexpr size_t MAX_DICTIONARY_STRING_LENGTH = 24;
+
+static constexpr uint8_t EDGE_UNDIRECTED = 0x1; // RecordHeader flag
+
+struct RecordHeader {
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t length; // Total record size in bytes
+    uint32_t id;     // Node, edge or key ID
+};
+
+// Property directory entry: key ID, type, then the inline INT/FLOAT value or the offset
+// of a length-prefixed string stored after the directory
+static constexpr size_t PROPERTY_ENTRY_SIZE = sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+// Interns strings into small integer codes shared by all records of a database
+template <typename Code>
+class Dictionary {
+private:
+    std::unordered_map<std::string, Code> codes;
+    std::deque<std::string> strings; // Deque keeps references stable as the dictionary grows
+
+public:
+    std::optional<Code> lookup(const std::string& str) const {
+        auto it = codes.find(str);
+        if (it != codes.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    const std::string& get(Code code) const {
+        return strings.at(code);
+    }
+
+    size_t size() const {
+        return strings.size();
+    }
+
+    // Register `str` under `code` (used when reloading dictionary records from disk)
+    void add(Code code, const std::string& str) {
+        if (strings.size() <= code) {
+            strings.resize(static_cast<size_t>(code) + 1);
+        }
+        strings[code] = str;
+        codes[str] = code;
+    }
+
+    Code add(const std::string& str) {
+        if (strings.size() > std::numeric_limits<Code>::max()) {
+            throw std::overflow_error("Dictionary is full");
+        }
+        Code code = static_cast<Code>(strings.size());
+        add(code, str);
+        return code;
+    }
+};
+
+using PropertyKeyCatalog = Dictionary<uint16_t>; // Property name <-> key ID
+using StringDictionary = Dictionary<uint32_t>;   // Short string value <-> code
+
+inline void beginRecord(std::string& buffer, RecordKind kind, uint8_t flags, uint32_t id) {
+    appendBytes(buffer, RecordHeader{kind, flags, 0, id});
+}
+
+// Patch the final size into the header once the record is complete
+inline void finishRecord(std::string& buffer) {
+    if (buffer.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::length_error("Record too large");
+    }
+    uint16_t length = static_cast<uint16_t>(buffer.size());
+    std::memcpy(&buffer[offsetof(RecordHeader, length)], &length, sizeof(length));
+}
+
+template <typename Names, typename Values>
+void encodeProperties(std::string& buffer, const Names& names, const Values& values, size_t count,
+                      const PropertyKeyCatalog& catalog, const StringDictionary& dictionary) {
+    appendBytes<uint8_t>(buffer, count);
+    size_t heap_offset = buffer.size() + count * PROPERTY_ENTRY_SIZE;
+    std::string heap;
+
+    for (size_t i = 0; i < count; ++i) {
+        auto key_id = catalog.lookup(names[i]);
+        if (!key_id.has_value()) {
+            throw std::logic_error("Property key was not interned: " + names[i]);
+        }
+        appendBytes<uint16_t>(buffer, *key_id);
+
+        const PropertyValue& value = values[i];
+        if (value.type == STRING) {
+            if (auto code = dictionary.lookup(std::get<std::string>(value.value))) {
+                appendBytes<uint8_t>(buffer, STORED_DICTIONARY_STRING);
+                appendBytes<uint32_t>(buffer, *code);
+                continue;
+            }
+        }
+
+        appendBytes<uint8_t>(buffer, value.type);
+        switch (value.type) {
+            case INT:
+                appendBytes<int32_t>(buffer, std::get<int>(value.value));
+                break;
+            case FLOAT:
+                appendBytes<float>(buffer, std::get<float>(value.value));
+                break;
+            case STRING: {
+                const auto& str = std::get<std::string>(value.value);
+                if (str.size() > std::numeric_limits<uint16_t>::max()) {
+                    throw std::length_error("String property too long");
+                }
+                appendBytes<uint32_t>(buffer, heap_offset + heap.size());
+                appendBytes<uint16_t>(heap, str.size());
+                heap.append(str);
+                break;
+            }
+        }
+    }
+    buffer.append(heap);
+}
+
+// KEY_RECORD or STRING_RECORD: header followed by the raw string bytes
+inline std::string encodeDictionaryRecord(RecordKind kind, uint32_t code, const std::string& str) {
+    std::string buffer;
+    beginRecord(buffer, kind, 0, code);
+    buffer.append(str);
+    finishRecord(buffer);
+    return buffer;
+}
+
+// META_RECORD: header followed by the name, a NUL byte and the value
+inline std::string encodeMetadataRecord(const std::string& name, const std::string& value) {
+    std::string buffer;
+    beginRecord(buffer, META_RECORD, 0, 0);
+    buffer.append(name);
+    buffer.push_back('\0');
+    buffer.append(value);
+    finishRecord(buffer);
+    return buffer;
+}
+
+// Class representing a node in the graph
+constexpr size_t MaxPropertyCount = 10;
+
+class Node {
+public:
+    uint32_t id; // Node ID
+    std::unordered_map<std::string, PropertyValue> properties; // Properties
+    size_t property_count = 0; // Current number of properties
+
+    // Constructor
+    Node(uint32_t id) : id(id) {}
+
+    // Add a property to the node
+    void addProperty(const std::string& name, const PropertyValue& value) {
+        if (property_count >= MaxPropertyCount) {
+            throw std::overflow_error("Maximum property count reached");
+        }
+        properties[name] = value;
+        property_count++;
+    }
+
+    // Get a property value by name
+    std::optional<PropertyValue> getProperty(const std::string& name) const {
+        auto it = properties.find(name);
+        if (it != properties.end()) {
+            return it->second;
+        }
+        return std::nullopt; // Property not found
+    }
+
+    bool removeProperty(const std::string& name) {
+        auto it = properties.find(name);
+        if (it != properties.end()) {
+            properties.erase(it);
+            property_count--;
+            return true;
+        }
+        return false;
+    }
+
+    // Print the node's details
+    void print() const {
+        std::cout << "Node " << id << " [ ";
+        for (const auto& [key, value] : properties) {
+            std::cout << key << ": ";
+            value.print();
+            std::cout << ", ";
+        }
+        std::cout << "]\n";
+    }
+};
+
+class SNode {
+public:
+    uint32_t id; // Node ID
+    std::array<std::string, MaxPropertyCount> property_names; // Property names (keys)
+    std::array<PropertyValue, MaxPropertyCount> property_values; // Property values
+    size_t property_count = 0; // Current number of properties
+
+    // Constructor
+    SNode(uint32_t id) : id(id) {}
+
+    // Add a property to the node, overwriting any previous value of the same name
+    void addProperty(const std::string& name, const PropertyValue& value) {
+        for (size_t i = 0; i < property_count; ++i) {
+            if (property_names[i] == name) {
+                property_values[i] = value;
+                return;
+            }
+        }
+        if (property_count >= MaxPropertyCount) {
+            throw std::overflow_error("Maximum property count reached");
+        }
+        property_names[property_count] = name;
+        property_values[property_count] = value;
+        property_count++;
+    }
+
+    // Encode as a NODE_RECORD, every property name must already be in `catalog`
+    std::string serialize(const PropertyKeyCatalog& catalog, const StringDictionary& dictionary) const {
+        std::string buffer;
+        beginRecord(buffer, NODE_RECORD, 0, id);
+        encodeProperties(buffer, property_names, property_values, property_count, catalog, dictionary);
+        finishRecord(buffer);
+        return buffer;
+    }
+
+    // Print the node's details
+    Node convert() const {
+        Node node(id); // Create a Node object with the same ID
+        for (size_t i = 0; i < property_count; ++i) {
+            node.addProperty(property_names[i], PropertyValue(property_values[i]));
+        }
+        return node;
+    }
+
+    void print() const {
+        std::cout << "Node " << id << " [ ";
+        for (size_t i = 0; i < property_count; ++i) {
+            std::cout << property_names[i] << ": ";
+            property_values[i].print();
+            std::cout << ", ";
+        }
+        std::cout << "]\n";
+    }
+};
+
+// Class representing an edge in the graph
+class Edge {
+public:
+    uint32_t id;
+    uint32_t source;
+    uint32_t target;
+    std::unordered_map<std::string, PropertyValue> properties;
+    size_t property_count = 0;
+
+    Edge(uint32_t id, uint32_t source, uint32_t target) : id(id), source(source), target(target) {}
+
+    void addProperty(const std::string& name, const PropertyValue& value) {
+        if (property_count >= MaxPropertyCount) {
+            throw std::overflow_error("Maximum property count reached");
+        }
+        properties[name] = value;
+        property_count++;
+    }
+
+    std::optional<PropertyValue> getProperty(const std::string& name) const {
+        auto it = properties.find(name);
+        if (it != properties.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    bool removeProperty(const std::string& name) {
+        auto it = properties.find(name);
+        if (it != properties.end()) {
+            properties.erase(it);
+            property_count--;
+            return true;
+        }
+        return false;
+    }
+
+    void print() const {
+        std::cout << "Edge " << id << " (" << source << " -> " << target << ") [ ";
+        for (const auto& [key, value] : properties) {
+            std::cout << key << ": ";
+            value.print();
+            std::cout << ", ";
+        }
+        std::cout << "]\n";
+    }
+};
+
+class SEdge {
+public:
+    uint32_t id;
+    uint32_t source;
+    uint32_t target;
+    std::array<std::string, MaxPropertyCount> property_names;
+    std::array<PropertyValue, MaxPropertyCount> property_values;
+    size_t property_count = 0;
+
+    SEdge(uint32_t id, uint32_t source, uint32_t target) : id(id), source(source), target(target) {}
+
+    // Add a property to the edge, overwriting any previous value of the same name
+    void addProperty(const std::string& name, const PropertyValue& value) {
+        for (size_t i = 0; i < property_count; ++i) {
+            if (property_names[i] == name) {
+                property_values[i] = value;
+                return;
+            }
+        }
+        if (property_count >= MaxPropertyCount) {
+            throw std::overflow_error("Maximum property count reached");
+        }
+        property_names[property_count] = name;
+        property_values[property_count] = value;
+        property_count++;
+    }
+
+    // Encode as an EDGE_RECORD, every property name must already be in `catalog`
+    std::string serialize(const PropertyKeyCatalog& catalog, const StringDictionary& dictionary, bool is_directed = true) const {
+        std::string buffer;
+        beginRecord(buffer, EDGE_RECORD, is_directed ? 0 : EDGE_UNDIRECTED, id);
+        appendBytes<uint32_t>(buffer, source);
+        appendBytes<uint32_t>(buffer, target);
+        encodeProperties(buffer, property_names, property_values, property_count, catalog, dictionary);
+        finishRecord(buffer);
+        return buffer;
+    }
+
+    Edge convert() const {
+        Edge edge(id, source, target);
+        for (size_t i = 0; i < property_count; ++i) {
+            edge.addProperty(property_names[i], property_values[i]);
+        }
+        return edge;
+    }
+
+    void print() const {
         std::cout << "Edge " << id << " (" << source << " -> " << target << ") [ ";
+        for (size_t i = 0; i < property_count; ++i) {
+            std::cout << property_names[i] << ": ";
+            property_values[i].print();
+            std::cout << ", ";
+        }
+        std::cout << "]\n";
+    }
+};
+
+// Zero-copy view over a record in page memory. Fields are decoded on access and
+// the view is valid only while its page stays in the buffer pool.
+class RecordView {
+protected:
+    const char* data;
+    size_t properties_offset; // Position of the property count byte
+    const StringDictionary* dictionary; // Resolves dictionary-encoded strings
+
+    const char* entry(size_t index) const {
+        return data + properties_offset + 1 + index * PROPERTY_ENTRY_SIZE;
+    }
+
+    // Inline value or string offset of a directory entry
+    const char* payload(size_t index) const {
+        return entry(index) + sizeof(uint16_t) + sizeof(uint8_t);
+    }
+
+public:
+    RecordView(const char* data, size_t properties_offset, const StringDictionary* dictionary = nullptr)
+        : data(data), properties_offset(properties_offset), dictionary(dictionary) {}
+
+    RecordHeader header() const {
+        const char* cursor = data;
+        return readBytes<RecordHeader>(cursor);
+    }
+
+    uint32_t id() const {
+        return header().id;
+    }
+
+    size_t propertyCount() const {
+        return static_cast<uint8_t>(data[properties_offset]);
+    }
+
+    uint16_t propertyKey(size_t index) const {
+        const char* cursor = entry(index);
+        return readBytes<uint16_t>(cursor);
+    }
+
+    StoredType storedType(size_t index) const {
+        return static_cast<StoredType>(static_cast<uint8_t>(entry(index)[sizeof(uint16_t)]));
+    }
+
+    FieldType propertyType(size_t index) const {
+        StoredType type = storedType(index);
+        return type == STORED_DICTIONARY_STRING ? STRING : static_cast<FieldType>(type);
+    }
+
+    PropertyValue propertyValue(size_t index) const {
+        const char* cursor = payload(index);
+        switch (storedType(index)) {
+            case STORED_INT:
+                return PropertyValue(static_cast<int>(readBytes<int32_t>(cursor)));
+            case STORED_FLOAT:
+                return PropertyValue(readBytes<float>(cursor));
+            case STORED_STRING: {
+                const char* str = data + readBytes<uint32_t>(cursor);
+                auto length = readBytes<uint16_t>(str);
+                return PropertyValue(std::string(str, length));
+            }
+            case STORED_DICTIONARY_STRING:
+                assert(dictionary != nullptr);
+                return PropertyValue(dictionary->get(readBytes<uint32_t>(cursor)));
+        }
+        throw std::runtime_error("Corrupt property entry");
+    }
+
+    // Dictionary code of a string property, compared instead of the string itself
+    std::optional<uint32_t> stringCode(uint16_t key_id) const {
+        auto index = findProperty(key_id);
+        if (!index.has_value() || storedType(*index) != STORED_DICTIONARY_STRING) {
+            return std::nullopt;
+        }
+        const char* cursor = payload(*index);
+        return readBytes<uint32_t>(cursor);
+    }
+
+    // Typed accessors by key ID. They read only the requested entry and never allocate;
+    // nullopt means the property is missing or has a different type.
+    std::optional<int> getInt(uint16_t key_id) const {
+        auto index = findProperty(key_id);
+        if (!index.has_value() || storedType(*index) != STORED_INT) {
+            return std::nullopt;
+        }
+        const char* cursor = payload(*index);
+        return static_cast<int>(readBytes<int32_t>(cursor));
+    }
+
+    std::optional<float> getFloat(uint16_t key_id) const {
+        auto index = findProperty(key_id);
+        if (!index.has_value() || storedType(*index) != STORED_FLOAT) {
+            return std::nullopt;
+        }
+        const char* cursor = payload(*index);
+        return readBytes<float>(cursor);
+    }
+
+    // Points into the page (inline strings) or the dictionary (coded strings)
+    std::optional<std::string_view> getString(uint16_t key_id) const {
+        auto index = findProperty(key_id);
+        if (!index.has_value()) {
+            return std::nullopt;
+        }
+        const char* cursor = payload(*index);
+        switch (storedType(*index)) {
+            case STORED_STRING: {
+                const char* str = data + readBytes<uint32_t>(cursor);
+                auto length = readBytes<uint16_t>(str);
+                return std::string_view(str, length);
+            }
+            case STORED_DICTIONARY_STRING: {
+                assert(dictionary != nullptr);
+                const std::string& str = dictionary->get(readBytes<uint32_t>(cursor));
+                return std::string_view(str);
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+
+    std::optional<size_t> findProperty(uint16_t key_id) const {
+        for (size_t i = 0; i < propertyCount(); ++i) {
+            if (propertyKey(i) == key_id) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+class NodeView : public RecordView {
+public:
+    NodeView(const char* data, const StringDictionary* dictionary = nullptr)
+        : RecordView(data, sizeof(RecordHeader), dictionary) {}
+
+    SNode materialize(const PropertyKeyCatalog& catalog) const {
+        SNode node(id());
+        for (size_t i = 0; i < propertyCount(); ++i) {
+            node.addProperty(catalog.get(propertyKey(i)), propertyValue(i));
+        }
+        return node;
+    }
+};
+
+class EdgeView : public RecordView {
+public:
+    EdgeView(const char* data, const StringDictionary* dictionary = nullptr)
+        : RecordView(data, sizeof(RecordHeader) + 2 * sizeof(uint32_t), dictionary) {}
+
+    uint32_t source() const {
+        const char* cursor = data + sizeof(RecordHeader);
+        return readBytes<uint32_t>(cursor);
+    }
+
+    uint32_t target() const {
+        const char* cursor = data + sizeof(RecordHeader) + sizeof(uint32_t);
+        return readBytes<uint32_t>(cursor);
+    }
+
+    bool isDirected() const {
+        return (header().flags & EDGE_UNDIRECTED) == 0;
+    }
+
+    SEdge materialize(const PropertyKeyCatalog& catalog) const {
+        SEdge edge(id(), source(), target());
+        for (size_t i = 0; i < propertyCount(); ++i) {
+            edge.addProperty(catalog.get(propertyKey(i)), propertyValue(i));
+        }
+        return edge;
+    }
+};
+
+// A record view bundled with the guard that keeps its page pinned and
+// share-latched; the view is only valid while this object is alive
+template <typename View>
+class PinnedView {
+private:
+    PageGuard guard;
+    View view;
+
+public:
+    PinnedView(PageGuard guard, View view)
+        : guard(std::move(guard)), view(view) {}
+
+    const View& operator*() const { return view; }
+    const View* operator->() const { return &view; }
+};
+
+enum class GraphType {
+    DIRECTED,
+    UNDIRECTED
+};
+
+static constexpr size_t MIN_DELTA_COMPACTION = 4096; // Pending edges before the CSR arrays are rebuilt
+static constexpr size_t DELTA_CHUNK_ROWS = 64; // Delta rows copied together when a shared index changes
+static constexpr uint32_t REMOVED_EDGE = 0; // Edge ID of a removed CSR entry; real edge IDs start at 1
+
+struct AdjacencyEntry {
+    uint32_t neighbor; // Target node ID
+    uint32_t edge_id;  // Edge record connecting the two nodes
+};
+
+// One source -> target edge of a bulk insert
+struct BatchEdge {
+    uint32_t source;
+    uint32_t target;
+    uint32_t edge_id;
+};
+
+// Compressed-sparse-row adjacency index.
+// Row `id` of the compacted part lives in neighbors/edge_ids[offsets[id] .. offsets[id + 1]),
+// sorted by neighbor ID. New edges go to a small per-node delta buffer (also sorted) and are
+// merged into the CSR arrays once enough of them have accumulated. Removed CSR entries keep
+// their place with edge ID REMOVED_EDGE until that merge drops them.
+// Copies are cheap: they share the CSR arrays and the delta rows, and each side copies a
+// part (the CSR arrays, or one chunk of DELTA_CHUNK_ROWS delta rows) before changing it.
+class AdjacencyIndex {
+private:
+    struct Csr {
+        std::vector<uint64_t> offsets = {0, 0}; // Indexed by node ID, slot 0 unused; newer nodes have empty rows
+        std::vector<uint32_t> neighbors;
+        std::vector<uint32_t> edge_ids;
+        uint64_t generation = 0; // Of the index that may modify it in place
+    };
+
+    struct DeltaChunk {
+        std::array<std::vector<AdjacencyEntry>, DELTA_CHUNK_ROWS> rows;
+        uint64_t generation = 0;
+    };
+
+    static inline std::atomic<uint64_t> next_generation{1};
+    static inline const std::vector<AdjacencyEntry> empty_row;
+
+    // Parts stamped with this index's generation are not shared with a copy
+    mutable uint64_t generation = next_generation++;
+    std::shared_ptr<Csr> csr = std::make_shared<Csr>();
+    std::vector<std::shared_ptr<DeltaChunk>> delta; // Chunk i holds rows i * DELTA_CHUNK_ROWS ..; null while empty
+    size_t num_nodes = 0;
+    size_t delta_count = 0;
+    size_t removed_count = 0; // CSR entries marked REMOVED_EDGE
+
+    static bool entryLess(const AdjacencyEntry& entry, uint32_t neighbor) {
+        return entry.neighbor < neighbor;
+    }
+
+    // Compacted row of `node_id` as [begin, end) positions in the CSR arrays
+    std::pair<uint64_t, uint64_t> csrRow(uint32_t node_id) const {
+        if (static_cast<size_t>(node_id) + 1 >= csr->offsets.size()) {
+            return {0, 0};
+        }
+        return {csr->offsets[node_id], csr->offsets[node_id + 1]};
+    }
+
+    const std::vector<AdjacencyEntry>& deltaRow(uint32_t node_id) const {
+        const auto& chunk = delta[node_id / DELTA_CHUNK_ROWS];
+        return chunk ? chunk->rows[node_id % DELTA_CHUNK_ROWS] : empty_row;
+    }
+
+    // Delta row of `node_id` for writing, copying its chunk first if a copy shares it
+    std::vector<AdjacencyEntry>& mutableDeltaRow(uint32_t node_id) {
+        auto& chunk = delta[node_id / DELTA_CHUNK_ROWS];
+        if (!chunk) {
+            chunk = std::make_shared<DeltaChunk>();
+            chunk->generation = generation;
+        } else if (chunk->generation != generation) {
+            chunk = std::make_shared<DeltaChunk>(*chunk);
+            chunk->generation = generation;
+        }
+        return chunk->rows[node_id % DELTA_CHUNK_ROWS];
+    }
+
+    // CSR arrays for writing, copying them first if a copy shares them
+    Csr& mutableCsr() {
+        if (csr->generation != generation) {
+            csr = std::make_shared<Csr>(*csr);
+            csr->generation = generation;
+        }
+        return *csr;
+    }
+
+    // Merge once pending inserts and removals make up a large enough part of the index
+    void compactIfNeeded() {
+        if (delta_count + removed_count >= std::max(MIN_DELTA_COMPACTION, csr->neighbors.size() / 4)) {
+            compact();
+        }
+    }
+
+    // Locate `target` in the compacted row of `source`, returns the array position if present
+    // (removed entries included)
+    std::optional<uint64_t> findCompacted(uint32_t source, uint32_t target) const {
+        auto [row_begin, row_end] = csrRow(source);
+        auto begin = csr->neighbors.begin() + row_begin;
+        auto end = csr->neighbors.begin() + row_end;
+        auto it = std::lower_bound(begin, end, target);
+        if (it != end && *it == target) {
+            return static_cast<uint64_t>(it - csr->neighbors.begin());
+        }
+        return std::nullopt;
+    }
+
+    void installCsr(std::vector<uint64_t> offsets, std::vector<uint32_t> neighbors, std::vector<uint32_t> edge_ids) {
+        auto fresh = std::make_shared<Csr>();
+        fresh->offsets = std::move(offsets);
+        fresh->neighbors = std::move(neighbors);
+        fresh->edge_ids = std::move(edge_ids);
+        fresh->generation = generation;
+        csr = std::move(fresh);
+    }
+
+public:
+    AdjacencyIndex() = default;
+
+    AdjacencyIndex(const AdjacencyIndex& other)
+        : csr(other.csr), delta(other.delta), num_nodes(other.num_nodes), delta_count(other.delta_count),
+          removed_count(other.removed_count) {
+        other.generation = next_generation++;
+    }
+
+    AdjacencyIndex& operator=(const AdjacencyIndex&) = delete;
+
+    // Make room for node IDs up to and including `node_id`
+    void ensureNode(uint32_t node_id) {
+        num_nodes = std::max<size_t>(num_nodes, node_id);
+        size_t chunks = num_nodes / DELTA_CHUNK_ROWS + 1;
+        if (delta.size() < chunks) {
+            delta.resize(chunks);
+        }
+    }
+
+    size_t numNodes() const {
+        return num_nodes;
+    }
+
+    size_t numEdges() const {
+        return csr->neighbors.size() - removed_count + delta_count;
+    }
+
+    // Insert (or overwrite) the edge source -> target, returns false if it already existed
+    bool addEdge(uint32_t source, uint32_t target, uint32_t edge_id) {
+        ensureNode(std::max(source, target));
+
+        if (auto pos = findCompacted(source, target)) {
+            uint32_t& entry = mutableCsr().edge_ids[*pos];
+            bool revived = entry == REMOVED_EDGE;
+            entry = edge_id;
+            if (revived) {
+                removed_count--;
+            }
+            return revived;
+        }
+
+        auto& row = mutableDeltaRow(source);
+        auto it = std::lower_bound(row.begin(), row.end(), target, entryLess);
+        if (it != row.end() && it->neighbor == target) {
+            it->edge_id = edge_id;
+            return false;
+        }
+        row.insert(it, AdjacencyEntry{target, edge_id});
+        delta_count++;
+        compactIfNeeded();
+        return true;
+    }
+
+    // Remove the edge source -> target, returns false if there was none
+    bool removeEdge(uint32_t source, uint32_t target) {
+        if (source < 1 || source > num_nodes) {
+            return false;
+        }
+        if (auto pos = findCompacted(source, target)) {
+            if (csr->edge_ids[*pos] == REMOVED_EDGE) {
+                return false;
+            }
+            mutableCsr().edge_ids[*pos] = REMOVED_EDGE;
+            removed_count++;
+        } else {
+            const auto& row = deltaRow(source);
+            auto it = std::lower_bound(row.begin(), row.end(), target, entryLess);
+            if (it == row.end() || it->neighbor != target) {
+                return false;
+            }
+            auto index = it - row.begin();
+            auto& mutable_row = mutableDeltaRow(source);
+            mutable_row.erase(mutable_row.begin() + index);
+            delta_count--;
+        }
+        compactIfNeeded();
+        return true;
+    }
+
+    std::optional<uint32_t> findEdge(uint32_t source, uint32_t target) const {
+        if (source < 1 || source > num_nodes) {
+            return std::nullopt;
+        }
+        if (auto pos = findCompacted(source, target)) {
+            if (csr->edge_ids[*pos] == REMOVED_EDGE) {
+                return std::nullopt;
+            }
+            return csr->edge_ids[*pos];
+        }
+        const auto& row = deltaRow(source);
+        auto it = std::lower_bound(row.begin(), row.end(), target, entryLess);
+        if (it != row.end() && it->neighbor == target) {
+            return it->edge_id;
+        }
+        return std::nullopt;
+    }
+
+    size_t degree(uint32_t node_id) const {
+        if (node_id < 1 || node_id > num_nodes) {
+            return 0;
+        }
+        auto [begin, end] = csrRow(node_id);
+        size_t removed = 0;
+        if (removed_count > 0) {
+            removed = std::count(csr->edge_ids.begin() + begin, csr->edge_ids.begin() + end, REMOVED_EDGE);
+        }
+        return end - begin - removed + deltaRow(node_id).size();
+    }
+
+    // Calls fn(neighbor, edge_id) for every out-edge of `node_id` in ascending neighbor order
+    template <typename Fn>
+    void forEachNeighbor(uint32_t node_id, Fn&& fn) const {
+        if (node_id < 1 || node_id > num_nodes) {
+            return;
+        }
+        auto [pos, end] = csrRow(node_id);
+        const auto& neighbors = csr->neighbors;
+        const auto& edge_ids = csr->edge_ids;
+        const auto& row = deltaRow(node_id);
+        size_t delta_pos = 0;
+
+        while (pos < end || delta_pos < row.size()) {
+            if (delta_pos == row.size() || (pos < end && neighbors[pos] < row[delta_pos].neighbor)) {
+                if (edge_ids[pos] != REMOVED_EDGE) {
+                    fn(neighbors[pos], edge_ids[pos]);
+                }
+                pos++;
+            } else {
+                fn(row[delta_pos].neighbor, row[delta_pos].edge_id);
+                delta_pos++;
+            }
+        }
+    }
+
+    // Returns true as soon as pred(neighbor, edge_id) holds for some out-edge of `node_id`
+    template <typename Pred>
+    bool anyNeighbor(uint32_t node_id, Pred&& pred) const {
+        if (node_id < 1 || node_id > num_nodes) {
+            return false;
+        }
+        auto [begin, end] = csrRow(node_id);
+        for (uint64_t pos = begin; pos < end; ++pos) {
+            if (csr->edge_ids[pos] != REMOVED_EDGE && pred(csr->neighbors[pos], csr->edge_ids[pos])) {
+                return true;
+            }
+        }
+        for (const auto& entry : deltaRow(node_id)) {
+            if (pred(entry.neighbor, entry.edge_id)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Merge every delta row into the CSR arrays and drop the removed entries
+    void compact() {
+        if (delta_count == 0 && removed_count == 0) {
+            return;
+        }
+        std::vector<uint64_t> new_offsets(num_nodes + 2, 0);
+        std::vector<uint32_t> new_neighbors;
+        std::vector<uint32_t> new_edge_ids;
+        new_neighbors.reserve(numEdges());
+        new_edge_ids.reserve(numEdges());
+
+        for (uint32_t node_id = 1; node_id <= num_nodes; ++node_id) {
+            new_offsets[node_id] = new_neighbors.size();
+            forEachNeighbor(node_id, [&](uint32_t neighbor, uint32_t edge_id) {
+                new_neighbors.push_back(neighbor);
+                new_edge_ids.push_back(edge_id);
+            });
+        }
+        new_offsets.back() = new_neighbors.size();
+
+        installCsr(std::move(new_offsets), std::move(new_neighbors), std::move(new_edge_ids));
+        std::fill(delta.begin(), delta.end(), nullptr);
+        delta_count = 0;
+        removed_count = 0;
+    }
+
+    // Insert a batch of edges with a single merge of the sorted batch into the CSR
+    // arrays, instead of one delta insert per edge. Same overwrite rules as addEdge,
+    // applied in batch order; inserted[i] tells whether batch[i] added a new pair.
+    std::vector<bool> addEdges(const std::vector<BatchEdge>& batch) {
+        std::vector<bool> inserted(batch.size(), false);
+        if (batch.empty()) {
+            return inserted;
+        }
+        compact();
+
+        uint32_t max_node = 0;
+        for (const BatchEdge& edge : batch) {
+            max_node = std::max({max_node, edge.source, edge.target});
+        }
+        ensureNode(max_node);
+
+        // Batch positions ordered by (source, target), ties kept in batch order
+        std::vector<uint32_t> order(batch.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return std::tie(batch[a].source, batch[a].target) < std::tie(batch[b].source, batch[b].target);
+        });
+
+        const auto& neighbors = csr->neighbors;
+        const auto& edge_ids = csr->edge_ids;
+        std::vector<uint64_t> new_offsets(num_nodes + 2, 0);
+        std::vector<uint32_t> new_neighbors;
+        std::vector<uint32_t> new_edge_ids;
+        new_neighbors.reserve(neighbors.size() + batch.size());
+        new_edge_ids.reserve(neighbors.size() + batch.size());
+
+        size_t next = 0;
+        for (uint32_t node_id = 1; node_id <= num_nodes; ++node_id) {
+            new_offsets[node_id] = new_neighbors.size();
+            auto [pos, end] = csrRow(node_id);
+
+            while (pos < end || (next < order.size() && batch[order[next]].source == node_id)) {
+                bool from_batch = next < order.size() && batch[order[next]].source == node_id;
+                if (!from_batch || (pos < end && neighbors[pos] < batch[order[next]].target)) {
+                    new_neighbors.push_back(neighbors[pos]);
+                    new_edge_ids.push_back(edge_ids[pos]);
+                    pos++;
+                    continue;
+                }
+
+                uint32_t target = batch[order[next]].target;
+                bool existed = pos < end && neighbors[pos] == target;
+                inserted[order[next]] = !existed;
+                // Later duplicates of the pair overwrite the edge ID, like repeated addEdge calls
+                uint32_t edge_id = batch[order[next]].edge_id;
+                for (next++; next < order.size() && batch[order[next]].source == node_id &&
+                             batch[order[next]].target == target; ++next) {
+                    edge_id = batch[order[next]].edge_id;
+                }
+                new_neighbors.push_back(target);
+                new_edge_ids.push_back(edge_id);
+                if (existed) {
+                    pos++;
+                }
+            }
+        }
+        new_offsets.back() = new_neighbors.size();
+
+        installCsr(std::move(new_offsets), std::move(new_neighbors), std::move(new_edge_ids));
+        return inserted;
+    }
+};
+
+// Growable bitset over node IDs
+class Bitmap {
+private:
+    std::vector<uint64_t> words;
+
+public:
+    Bitmap(size_t bits = 0) : words((bits + 63) / 64, 0) {}
+    explicit Bitmap(std::vector<uint64_t> words) : words(std::move(words)) {}
+
+    size_t size() const {
+        return words.size() * 64;
+    }
+
+    void set(size_t bit) {
+        if (bit >= size()) {
+            words.resize(bit / 64 + 1, 0);
+        }
+        words[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+
+    void reset(size_t bit) {
+        if (bit < size()) {
+            words[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+        }
+    }
+
+    bool test(size_t bit) const {
+        return bit < size() && (words[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : words) {
+            total += __builtin_popcountll(word);
+        }
+        return total;
+    }
+
+    // Calls fn(bit) for every set bit in ascending order
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t word = words[w];
+            while (word != 0) {
+                fn(w * 64 + __builtin_ctzll(word));
+                word &= word - 1;
+            }
+        }
+    }
+};
+
+// Fixed-size bitset whose bits can be claimed concurrently
+class AtomicBitmap {
+private:
+    size_t num_words;
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+
+public:
+    AtomicBitmap(size_t bits) : num_words((bits + 63) / 64), words(std::make_unique<std::atomic<uint64_t>[]>(num_words)) {}
+
+    bool test(size_t bit) const {
+        return (words[bit / 64].load(std::memory_order_relaxed) >> (bit % 64)) & 1;
+    }
+
+    // Set the bit, returns true only for the caller that changed it from 0 to 1
+    bool trySet(size_t bit) {
+        uint64_t mask = uint64_t(1) << (bit % 64);
+        return (words[bit / 64].fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+    }
+};
+
+static constexpr size_t ARRAY_CHUNK_SIZE = 1024; // Elements copied together when a shared ChunkedArray changes
+
+// Growable array of per-node state whose copies share fixed-size chunks, like the delta
+// rows of AdjacencyIndex: each side copies one chunk of ARRAY_CHUNK_SIZE elements before
+// changing it, so a copy-on-write version costs a copy of the chunk pointers only.
+template <typename T>
+class ChunkedArray {
+private:
+    struct Chunk {
+        std::array<T, ARRAY_CHUNK_SIZE> values;
+        uint64_t generation = 0;
+    };
+
+    static inline std::atomic<uint64_t> next_generation{1};
+
+    // Chunks stamped with this array's generation are not shared with a copy
+    mutable uint64_t generation = next_generation++;
+    std::vector<std::shared_ptr<Chunk>> chunks; // Null while every element of the chunk is `fill`
+    size_t length = 0;
+    T fill;
+
+public:
+    explicit ChunkedArray(T fill = T()) : fill(fill) {}
+
+    ChunkedArray(const ChunkedArray& other) : chunks(other.chunks), length(other.length), fill(other.fill) {
+        other.generation = next_generation++;
+    }
+
+    ChunkedArray& operator=(const ChunkedArray&) = delete;
+
+    size_t size() const {
+        return length;
+    }
+
+    const T& operator[](size_t i) const {
+        const auto& chunk = chunks[i / ARRAY_CHUNK_SIZE];
+        return chunk ? chunk->values[i % ARRAY_CHUNK_SIZE] : fill;
+    }
+
+    // Grow to `size` elements; new elements are `fill`
+    void resize(size_t size) {
+        length = std::max(length, size);
+        chunks.resize((length + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE);
+    }
+
+    // Element `i` for writing, growing the array to cover it and copying its chunk first if
+    // a copy shares it
+    T& mutableAt(size_t i) {
+        resize(i + 1);
+        auto& chunk = chunks[i / ARRAY_CHUNK_SIZE];
+        if (!chunk) {
+            chunk = std::make_shared<Chunk>();
+            chunk->values.fill(fill);
+            chunk->generation = generation;
+        } else if (chunk->generation != generation) {
+            chunk = std::make_shared<Chunk>(*chunk);
+            chunk->generation = generation;
+        }
+        return chunk->values[i % ARRAY_CHUNK_SIZE];
+    }
+};
+
+static constexpr uint32_t NO_LABEL = std::numeric_limits<uint32_t>::max();
+const std::string LABEL_PROPERTY = "type"; // Node property that acts as its label
+const std::string POST_LABEL = "post";      // Label of nodes whose likes are aggregated
+const std::string LIKES_PROPERTY = "likes";
+
+// In-memory node label index: the label (dictionary code of the `type` property) of every
+// node in a dense array, plus one bitmap of member nodes per label. Both are chunked, so
+// the copy a writer makes after a snapshot shares every chunk it does not change.
+class LabelIndex {
+private:
+    ChunkedArray<uint32_t> node_labels{NO_LABEL}; // Node ID -> label code, NO_LABEL if unlabeled
+    std::unordered_map<uint32_t, ChunkedArray<uint64_t>> label_nodes; // Label code -> bitmap words
+
+public:
+    void setLabel(uint32_t node_id, uint32_t label) {
+        uint32_t previous = labelOf(node_id);
+        if (previous == label) {
+            return;
+        }
+        uint64_t mask = uint64_t(1) << (node_id % 64);
+        if (previous != NO_LABEL) {
+            label_nodes[previous].mutableAt(node_id / 64) &= ~mask;
+        }
+        node_labels.mutableAt(node_id) = label;
+        if (label != NO_LABEL) {
+            label_nodes[label].mutableAt(node_id / 64) |= mask;
+        }
+    }
+
+    uint32_t labelOf(uint32_t node_id) const {
+        return node_id < node_labels.size() ? node_labels[node_id] : NO_LABEL;
+    }
+
+    // Nodes carrying `label`; resolve once per query and test bits in the hot loop
+    Bitmap nodesWithLabel(uint32_t label) const {
+        auto it = label_nodes.find(label);
+        if (it == label_nodes.end()) {
+            return Bitmap();
+        }
+        std::vector<uint64_t> words(it->second.size());
+        for (size_t w = 0; w < words.size(); ++w) {
+            words[w] = it->second[w];
+        }
+        return Bitmap(std::move(words));
+    }
+};
+
+// Every B+-tree node is one record filling its own page
+static constexpr size_t INDEX_NODE_SIZE = MAX_RECORD_SIZE;
+static constexpr size_t MAX_INDEX_STRING_LENGTH = 256; // Longer string values are indexed by this prefix
+static constexpr uint8_t INDEX_LEAF = 0x1; // RecordHeader flag
+
+// In-memory copy of a B+-tree node. A leaf maps keys[i] -> values[i] and links to the next
+// leaf; an inner node has one more child page than keys, and values[i + 1] holds the keys
+// that are >= keys[i].
+struct IndexNode {
+    bool leaf = true;
+    PageID next_leaf = INVALID_PAGE_ID;
+    std::vector<std::string> keys;
+    std::vector<uint32_t> values;
+
+    static size_t entrySize(const std::string& key) {
+        return sizeof(uint16_t) + key.size() + sizeof(uint32_t);
+    }
+
+    size_t encodedSize() const {
+        size_t size = sizeof(RecordHeader) + sizeof(uint16_t) + sizeof(uint32_t);
+        for (const std::string& key : keys) {
+            size += entrySize(key);
+        }
+        return size;
+    }
+
+    // INDEX_RECORD: header, key count, next leaf (leaf) or first child (inner), then
+    // (key length, key, value or following child) entries, padded to INDEX_NODE_SIZE
+    std::string encode() const {
+        std::string buffer;
+        beginRecord(buffer, INDEX_RECORD, leaf ? INDEX_LEAF : 0, 0);
+        appendBytes<uint16_t>(buffer, keys.size());
+        appendBytes<uint32_t>(buffer, leaf ? next_leaf : values[0]);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            appendBytes<uint16_t>(buffer, keys[i].size());
+            buffer.append(keys[i]);
+            appendBytes<uint32_t>(buffer, values[leaf ? i : i + 1]);
+        }
+        finishRecord(buffer);
+        assert(buffer.size() <= INDEX_NODE_SIZE);
+        buffer.resize(INDEX_NODE_SIZE, '\0');
+        return buffer;
+    }
+
+    static IndexNode decode(const char* record) {
+        IndexNode node;
+        const char* cursor = record;
+        RecordHeader header = readBytes<RecordHeader>(cursor);
+        assert(header.kind == INDEX_RECORD);
+        node.leaf = (header.flags & INDEX_LEAF) != 0;
+        auto count = readBytes<uint16_t>(cursor);
+        auto link = readBytes<uint32_t>(cursor);
+        if (node.leaf) {
+            node.next_leaf = link;
+        } else {
+            node.values.push_back(link);
+        }
+        node.keys.reserve(count);
+        for (uint16_t i = 0; i < count; ++i) {
+            auto length = readBytes<uint16_t>(cursor);
+            node.keys.emplace_back(cursor, length);
+            cursor += length;
+            node.values.push_back(readBytes<uint32_t>(cursor));
+        }
+        return node;
+    }
+
+    // Move the upper half (by bytes) into a new right sibling; returns it and the
+    // separator key the parent needs to tell the two apart
+    std::pair<IndexNode, std::string> split() {
+        size_t half = encodedSize() / 2;
+        size_t size = sizeof(RecordHeader) + sizeof(uint16_t) + sizeof(uint32_t);
+        size_t mid = 0;
+        while (mid + 1 < keys.size() && size + entrySize(keys[mid]) < half) {
+            size += entrySize(keys[mid++]);
+        }
+        mid = std::max<size_t>(mid, 1);
+
+        IndexNode right;
+        right.leaf = leaf;
+        std::string separator = keys[mid];
+        if (leaf) {
+            right.keys.assign(keys.begin() + mid, keys.end());
+            right.values.assign(values.begin() + mid, values.end());
+            right.next_leaf = next_leaf;
+            values.resize(mid);
+        } else {
+            // The separator moves up and is not kept in either inner node
+            right.keys.assign(keys.begin() + mid + 1, keys.end());
+            right.values.assign(values.begin() + mid + 1, values.end());
+            values.resize(mid + 1);
+        }
+        keys.resize(mid);
+        return {std::move(right), std::move(separator)};
+    }
+};
+
+// B+-tree over unique byte-string keys with 32-bit values, one node per buffer-managed
+// page. The root never moves (a root split copies it into two new children), so the
+// root page ID names the tree for good. Deletes leave underfull nodes as they are.
+class BTreeIndex {
+private:
+    BufferManager* buffer_manager;
+    PageID root;
+
+    IndexNode readNode(PageID page_id) const {
+        PageGuard page = buffer_manager->fix_page(page_id);
+        return IndexNode::decode(page->getRecord(0));
+    }
+
+    void writeNode(PageID page_id, const IndexNode& node) {
+        std::string record = node.encode();
+        PageGuard page = buffer_manager->fix_page(page_id, true);
+        if (!page.updateRecord(0, record.data(), record.size())) {
+            [[maybe_unused]] auto slot = page.addRecord(record.data(), record.size());
+            assert(slot == 0);
+        }
+    }
+
+    PageID allocateNode(const IndexNode& node) {
+        PageID page_id = buffer_manager->allocatePage();
+        writeNode(page_id, node);
+        return page_id;
+    }
+
+    // Position of the child whose subtree holds `key`
+    static size_t childIndex(const IndexNode& node, const std::string& key) {
+        return std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin();
+    }
+
+    // Walk from the root to the leaf that holds `key`, returning the inner pages passed
+    PageID findLeaf(const std::string& key, IndexNode& node, std::vector<PageID>* path = nullptr) const {
+        PageID page_id = root;
+        node = readNode(page_id);
+        while (!node.leaf) {
+            if (path != nullptr) {
+                path->push_back(page_id);
+            }
+            page_id = node.values[childIndex(node, key)];
+            node = readNode(page_id);
+        }
+        return page_id;
+    }
+
+public:
+    BTreeIndex(BufferManager& buffer_manager, PageID root) : buffer_manager(&buffer_manager), root(root) {}
+
+    // Allocate the root page of a new, empty tree
+    static BTreeIndex create(BufferManager& buffer_manager) {
+        BTreeIndex tree(buffer_manager, INVALID_PAGE_ID);
+        tree.root = tree.allocateNode(IndexNode());
+        return tree;
+    }
+
+    PageID rootPage() const {
+        return root;
+    }
+
+    // Insert `key`, overwriting the value if it is already present
+    void insert(const std::string& key, uint32_t value) {
+        IndexNode node;
+        std::vector<PageID> path;
+        PageID page_id = findLeaf(key, node, &path);
+
+        auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+        size_t pos = it - node.keys.begin();
+        if (it != node.keys.end() && *it == key) {
+            node.values[pos] = value;
+            writeNode(page_id, node);
+            return;
+        }
+        node.keys.insert(it, key);
+        node.values.insert(node.values.begin() + pos, value);
+
+        // Split upwards while the node no longer fits its page
+        while (node.encodedSize() > INDEX_NODE_SIZE) {
+            auto [right, separator] = node.split();
+            if (page_id == root) {
+                PageID right_page = allocateNode(right);
+                if (node.leaf) {
+                    node.next_leaf = right_page;
+                }
+                PageID left_page = allocateNode(node);
+
+                IndexNode new_root;
+                new_root.leaf = false;
+                new_root.keys.push_back(separator);
+                new_root.values = {left_page, right_page};
+                writeNode(root, new_root);
+                return;
+            }
+
+            PageID right_page = allocateNode(right);
+            if (node.leaf) {
+                node.next_leaf = right_page;
+            }
+            writeNode(page_id, node);
+
+            page_id = path.back();
+            path.pop_back();
+            node = readNode(page_id);
+            size_t child = childIndex(node, separator);
+            node.keys.insert(node.keys.begin() + child, separator);
+            node.values.insert(node.values.begin() + child + 1, right_page);
+        }
+        writeNode(page_id, node);
+    }
+
+    // Remove `key`, returns false if it was not present
+    bool erase(const std::string& key) {
+        IndexNode node;
+        PageID page_id = findLeaf(key, node);
+        auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key);
+        if (it == node.keys.end() || *it != key) {
+            return false;
+        }
+        node.values.erase(node.values.begin() + (it - node.keys.begin()));
+        node.keys.erase(it);
+        writeNode(page_id, node);
+        return true;
+    }
+
+    // Calls fn(key, value) in key order for the keys >= `from` until it returns false
+    template <typename Fn>
+    void scan(const std::string& from, Fn&& fn) const {
+        IndexNode node;
+        findLeaf(from, node);
+        size_t pos = std::lower_bound(node.keys.begin(), node.keys.end(), from) - node.keys.begin();
+        while (true) {
+            for (; pos < node.keys.size(); ++pos) {
+                if (!fn(node.keys[pos], node.values[pos])) {
+                    return;
+                }
+            }
+            if (node.next_leaf == INVALID_PAGE_ID) {
+                return;
+            }
+            node = readNode(node.next_leaf);
+            pos = 0;
+        }
+    }
+};
+
+// Order-preserving byte encoding of a property value: a type byte, then a big-endian int
+// with the sign bit flipped, a float whose bits are flipped so that negatives sort first,
+// or the string bytes (cut at MAX_INDEX_STRING_LENGTH) followed by a NUL. Encodings compare
+// bytewise in the same order as PropertyValue::operator<.
+inline std::string encodeIndexValue(const PropertyValue& value) {
+    std::string key(1, static_cast<char>(value.type));
+    auto appendBigEndian = [&key](uint32_t bits) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            key.push_back(static_cast<char>((bits >> shift) & 0xff));
+        }
+    };
+    switch (value.type) {
+        case INT:
+            appendBigEndian(static_cast<uint32_t>(std::get<int>(value.value)) ^ 0x80000000u);
+            break;
+        case FLOAT: {
+            uint32_t bits;
+            float f = std::get<float>(value.value);
+            std::memcpy(&bits, &f, sizeof(bits));
+            appendBigEndian((bits & 0x80000000u) ? ~bits : bits ^ 0x80000000u);
+            break;
+        }
+        case STRING: {
+            const std::string& str = std::get<std::string>(value.value);
+            key.append(str, 0, MAX_INDEX_STRING_LENGTH);
+            key.push_back('\0');
+            break;
+        }
+    }
+    return key;
+}
+
+inline bool isIndexPrefixOf(const std::string& prefix, const std::string& key) {
+    return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Condition on one property, in PropertyValue order. Missing bounds are open, but only up
+// to the end of the other bound's type, so `likes > 100` does not match string values.
+struct PropertyPredicate {
+    std::string property;
+    std::optional<PropertyValue> low;
+    std::optional<PropertyValue> high;
+    bool low_inclusive = true;
+    bool high_inclusive = true;
+
+    static PropertyPredicate equals(const std::string& property, const PropertyValue& value) {
+        return {property, value, value, true, true};
+    }
+
+    static PropertyPredicate between(const std::string& property, const PropertyValue& low, const PropertyValue& high) {
+        return {property, low, high, true, true};
+    }
+
+    static PropertyPredicate greaterThan(const std::string& property, const PropertyValue& value) {
+        return {property, value, std::nullopt, false, true};
+    }
+
+    static PropertyPredicate atLeast(const std::string& property, const PropertyValue& value) {
+        return {property, value, std::nullopt, true, true};
+    }
+
+    static PropertyPredicate lessThan(const std::string& property, const PropertyValue& value) {
+        return {property, std::nullopt, value, true, false};
+    }
+
+    static PropertyPredicate atMost(const std::string& property, const PropertyValue& value) {
+        return {property, std::nullopt, value, true, true};
+    }
+
+    bool matches(const PropertyValue& value) const {
+        if (low.has_value() != high.has_value() && value.type != (low ? low : high)->type) {
+            return false;
+        }
+        if (low && (low_inclusive ? value < *low : !(*low < value))) {
+            return false;
+        }
+        if (high && (high_inclusive ? *high < value : !(value < *high))) {
+            return false;
+        }
+        return true;
+    }
+
+    // Index keys of strings this long are cut, so index answers need rechecking
+    bool needsRecheck() const {
+        auto isCut = [](const std::optional<PropertyValue>& bound) {
+            return bound && bound->type == STRING && std::get<std::string>(bound->value).size() >= MAX_INDEX_STRING_LENGTH;
+        };
+        return isCut(low) || isCut(high);
+    }
+};
+
+// Persistent index over one node or edge property. Entries are (encoded value, ID) keys in
+// a B+-tree, so duplicate values are kept apart and come back in ID order.
+class PropertyIndex {
+private:
+    BTreeIndex tree;
+
+    static std::string entryKey(const PropertyValue& value, uint32_t id) {
+        std::string key = encodeIndexValue(value);
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            key.push_back(static_cast<char>((id >> shift) & 0xff));
+        }
+        return key;
+    }
+
+    std::vector<uint32_t> findWithPrefix(const std::string& prefix) const {
+        std::vector<uint32_t> ids;
+        tree.scan(prefix, [&](const std::string& key, uint32_t id) {
+            if (!isIndexPrefixOf(prefix, key)) {
+                return false;
+            }
+            ids.push_back(id);
+            return true;
+        });
+        return ids;
+    }
+
+public:
+    explicit PropertyIndex(BTreeIndex tree) : tree(tree) {}
+
+    PageID rootPage() const {
+        return tree.rootPage();
+    }
+
+    void insert(const PropertyValue& value, uint32_t id) {
+        tree.insert(entryKey(value, id), id);
+    }
+
+    void erase(const PropertyValue& value, uint32_t id) {
+        tree.erase(entryKey(value, id));
+    }
+
+    // IDs whose value is `value`. Strings of MAX_INDEX_STRING_LENGTH or more also match
+    // others with the same prefix, so callers recheck those.
+    std::vector<uint32_t> find(const PropertyValue& value) const {
+        return findWithPrefix(encodeIndexValue(value));
+    }
+
+    // IDs with a string value starting with `prefix`
+    std::vector<uint32_t> findStringPrefix(const std::string& prefix) const {
+        std::string encoded = encodeIndexValue(PropertyValue(prefix));
+        encoded.pop_back(); // Drop the terminator so longer strings match too
+        return findWithPrefix(encoded);
+    }
+
+    // IDs whose value satisfies the bounds of `predicate`, in value order
+    std::vector<uint32_t> find(const PropertyPredicate& predicate) const {
+        std::string low = predicate.low ? encodeIndexValue(*predicate.low) : std::string();
+        std::string high = predicate.high ? encodeIndexValue(*predicate.high) : std::string();
+        // An open side stays within the type of the other bound
+        std::string start = predicate.low ? low : high.substr(0, 1);
+        char type = predicate.low ? low[0] : (predicate.high ? high[0] : 0);
+        // A cut bound also stands for longer values inside the range, so its keys are
+        // scanned inclusively and the caller's recheck drops the ones outside
+        bool low_inclusive = predicate.low_inclusive || predicate.needsRecheck();
+        bool high_inclusive = predicate.high_inclusive || predicate.needsRecheck();
+
+        std::vector<uint32_t> ids;
+        tree.scan(start, [&](const std::string& key, uint32_t id) {
+            if (predicate.high) {
+                int order = key.compare(0, high.size(), high);
+                if (order > 0 || (order == 0 && !high_inclusive)) {
+                    return false;
+                }
+            } else if (predicate.low && key[0] != type) {
+                return false;
+            }
+            if (predicate.low && !low_inclusive && isIndexPrefixOf(low, key)) {
+                return true; // Equal to an exclusive lower bound
+            }
+            ids.push_back(id);
+            return true;
+        });
+        return ids;
+    }
+};
+
+static constexpr size_t BFS_ALPHA = 14; // Go bottom-up once frontier edges exceed unexplored edges / ALPHA
+static constexpr size_t BFS_BETA = 24;  // Go back top-down once the frontier shrinks below nodes / BETA
+static constexpr size_t BFS_GRAIN = 256; // Frontier entries or nodes handed to a worker at a time
+
+// Path found by a shortest-path search, edges[i] connects nodes[i] -> nodes[i + 1]
+struct GraphPath {
+    std::vector<uint32_t> nodes;
+    std::vector<uint32_t> edges;
+
+    size_t length() const {
+        return edges.size();
+    }
+};
+
+enum class BfsMode {
+    AUTO,      // Direction-optimizing: switch between the two per level
+    TOP_DOWN,
+    BOTTOM_UP
+};
+
+// Level-synchronous, direction-optimizing BFS (Beamer et al.) over an adjacency index and
+// its reverse. Top-down levels expand a sparse frontier list through out-edges; bottom-up
+// levels scan unvisited nodes and look for a parent in a frontier bitmap through in-edges,
+// which is much cheaper once the frontier covers a large part of the graph.
+// With a thread pool each level is split across the workers: nodes are claimed through an
+// atomic visited bitmap and collected in per-worker buffers.
+class BfsEngine {
+private:
+    const AdjacencyIndex& out_edges;
+    const AdjacencyIndex& in_edges;
+    size_t num_nodes; // Node IDs are 1..num_nodes
+    BfsMode mode;
+    ThreadPool* pool; // nullptr runs every level on the calling thread
+
+    template <typename Fn>
+    void forRange(size_t count, Fn&& fn) const {
+        if (pool == nullptr || count <= BFS_GRAIN) {
+            fn(0, 0, count);
+        } else {
+            pool->parallelFor(count, BFS_GRAIN, fn);
+        }
+    }
+
+public:
+    BfsEngine(const AdjacencyIndex& out_edges, const AdjacencyIndex& in_edges, size_t num_nodes,
+              BfsMode mode = BfsMode::AUTO, ThreadPool* pool = nullptr)
+        : out_edges(out_edges), in_edges(in_edges), num_nodes(num_nodes), mode(mode), pool(pool) {}
+
+    // Calls on_level(depth, frontier) with the nodes first reached at each depth up to
+    // `max_depth`; returning false from on_level stops the search. Frontiers are sorted by
+    // node ID, so the output does not depend on the direction or the number of threads.
+    template <typename Fn>
+    void run(uint32_t source, size_t max_depth, Fn&& on_level) const {
+        AtomicBitmap visited(num_nodes + 1);
+        visited.trySet(source);
+        std::vector<uint32_t> frontier = {source};
+        std::vector<uint32_t> next;
+        std::vector<std::vector<uint32_t>> worker_next(pool ? pool->size() : 1);
+        size_t unexplored_edges = out_edges.numEdges() - out_edges.degree(source);
+        bool bottom_up = mode == BfsMode::BOTTOM_UP;
+
+        for (size_t depth = 1; depth <= max_depth && !frontier.empty(); ++depth) {
+            if (mode == BfsMode::AUTO) {
+                size_t frontier_edges = 0;
+                for (uint32_t node : frontier) {
+                    frontier_edges += out_edges.degree(node);
+                }
+                if (!bottom_up && frontier_edges > unexplored_edges / BFS_ALPHA) {
+                    bottom_up = true;
+                } else if (bottom_up && frontier.size() < num_nodes / BFS_BETA) {
+                    bottom_up = false;
+                }
+            }
+
+            for (auto& buffer : worker_next) {
+                buffer.clear();
+            }
+            if (bottom_up) {
+                Bitmap frontier_bits(num_nodes + 1);
+                for (uint32_t node : frontier) {
+                    frontier_bits.set(node);
+                }
+                forRange(num_nodes, [&](size_t worker, size_t begin, size_t end) {
+                    for (uint32_t node = begin + 1; node <= end; ++node) {
+                        if (visited.test(node)) {
+                            continue;
+                        }
+                        if (in_edges.anyNeighbor(node, [&](uint32_t parent, uint32_t) { return frontier_bits.test(parent); })) {
+                            worker_next[worker].push_back(node);
+                        }
+                    }
+                });
+            } else {
+                forRange(frontier.size(), [&](size_t worker, size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        out_edges.forEachNeighbor(frontier[i], [&](uint32_t neighbor, uint32_t) {
+                            if (!visited.test(neighbor) && visited.trySet(neighbor)) {
+                                worker_next[worker].push_back(neighbor);
+                            }
+                        });
+                    }
+                });
+            }
+
+            next.clear();
+            for (const auto& buffer : worker_next) {
+                next.insert(next.end(), buffer.begin(), buffer.end());
+            }
+            std::sort(next.begin(), next.end());
+            if (bottom_up) {
+                // Claimed after the scan so no node is reached through a parent of the same level
+                for (uint32_t node : next) {
+                    visited.trySet(node);
+                }
+            }
+
+            for (uint32_t node : next) {
+                unexplored_edges -= out_edges.degree(node);
+            }
+            frontier.swap(next);
+            if (!frontier.empty() && !on_level(depth, frontier)) {
+                return;
+            }
+        }
+    }
+
+    // Bidirectional BFS: grows a forward search from `source` over out-edges and a backward
+    // search from `target` over in-edges, always expanding the cheaper frontier by one full
+    // level, and stops at the first level where the two meet. Returns nullopt if there is no
+    // path of at most `max_hops` edges.
+    std::optional<GraphPath> shortestPath(uint32_t source, uint32_t target, size_t max_hops) const {
+        struct Step {
+            uint32_t next;  // Neighbor one hop closer to this search's root
+            uint32_t edge;
+            size_t depth;
+        };
+        using Steps = std::unordered_map<uint32_t, Step>;
+
+        if (source == target) {
+            return GraphPath{{source}, {}};
+        }
+
+        Steps forward_steps{{source, Step{source, 0, 0}}};
+        Steps backward_steps{{target, Step{target, 0, 0}}};
+        std::vector<uint32_t> forward_frontier = {source};
+        std::vector<uint32_t> backward_frontier = {target};
+        size_t forward_depth = 0, backward_depth = 0;
+
+        auto frontierCost = [](const std::vector<uint32_t>& frontier, const AdjacencyIndex& edges) {
+            size_t cost = 0;
+            for (uint32_t node : frontier) {
+                cost += edges.degree(node);
+            }
+            return cost;
+        };
+
+        while (forward_depth + backward_depth < max_hops && !forward_frontier.empty() && !backward_frontier.empty()) {
+            bool forward = frontierCost(forward_frontier, out_edges) <= frontierCost(backward_frontier, in_edges);
+            auto& frontier = forward ? forward_frontier : backward_frontier;
+            auto& steps = forward ? forward_steps : backward_steps;
+            const auto& other_steps = forward ? backward_steps : forward_steps;
+            const AdjacencyIndex& edges = forward ? out_edges : in_edges;
+            size_t depth = (forward ? ++forward_depth : ++backward_depth);
+
+            // Finish the whole level and keep the meeting point with the shortest total path
+            std::optional<uint32_t> meeting;
+            size_t best_length = SIZE_MAX;
+            std::vector<uint32_t> next;
+            for (uint32_t node : frontier) {
+                edges.forEachNeighbor(node, [&](uint32_t neighbor, uint32_t edge_id) {
+                    if (steps.count(neighbor)) {
+                        return;
+                    }
+                    steps.emplace(neighbor, Step{node, edge_id, depth});
+                    next.push_back(neighbor);
+
+                    auto other = other_steps.find(neighbor);
+                    if (other != other_steps.end() && depth + other->second.depth < best_length) {
+                        best_length = depth + other->second.depth;
+                        meeting = neighbor;
+                    }
+                });
+            }
+            frontier.swap(next);
+
+            if (meeting.has_value()) {
+                GraphPath path;
+                for (uint32_t node = *meeting; node != source; node = forward_steps.at(node).next) {
+                    path.nodes.push_back(node);
+                    path.edges.push_back(forward_steps.at(node).edge);
+                }
+                path.nodes.push_back(source);
+                std::reverse(path.nodes.begin(), path.nodes.end());
+                std::reverse(path.edges.begin(), path.edges.end());
+
+                for (uint32_t node = *meeting; node != target;) {
+                    const Step& step = backward_steps.at(node);
+                    path.edges.push_back(step.edge);
+                    node = step.next;
+                    path.nodes.push_back(node);
+                }
+                return path;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+// Node properties that get a persistent index once a node carries them
+const std::vector<std::string> INDEXED_NODE_PROPERTIES = {"name", "user_id"};
+const std::string NODE_INDEX_METADATA = "node_index:"; // + property name -> root page of its index
+const std::string EDGE_INDEX_METADATA = "edge_index:";
+// First unassigned ID, stored once the record holding the highest ID has been removed
+const std::string NEXT_NODE_ID_METADATA = "next_node_id";
+const std::string NEXT_EDGE_ID_METADATA = "next_edge_id";
+
+static constexpr size_t FSM_CATEGORY_BYTES = 128; // Free-space map granularity
+
+// Free space of the pages holding one kind of record, so inserts find a page with room
+// without probing pages. Pages are bucketed by free space in steps of FSM_CATEGORY_BYTES
+// (a page in bucket c has at least c * FSM_CATEGORY_BYTES bytes free); a lookup checks
+// the buckets from the smallest one that is large enough, a fixed number of them.
+class FreeSpaceMap {
+private:
+    static constexpr size_t NUM_CATEGORIES = PAGE_SIZE / FSM_CATEGORY_BYTES + 1;
+    static constexpr uint8_t UNTRACKED = std::numeric_limits<uint8_t>::max();
+
+    std::vector<uint8_t> categories; // Page ID -> bucket, UNTRACKED if the page is not in the map
+    std::vector<uint32_t> positions; // Page ID -> index within its bucket
+    std::array<std::vector<PageID>, NUM_CATEGORIES> buckets;
+
+public:
+    PageID insert_page = INVALID_PAGE_ID; // Page currently receiving new records
+
+    // Record how large a record `page_id` can now take (SlottedPage::freeSpace)
+    void update(PageID page_id, size_t free_bytes) {
+        if (categories.size() <= page_id) {
+            categories.resize(page_id + 1, UNTRACKED);
+            positions.resize(page_id + 1);
+        }
+        auto category = static_cast<uint8_t>(std::min(free_bytes / FSM_CATEGORY_BYTES, NUM_CATEGORIES - 1));
+        if (categories[page_id] == category) {
+            return;
+        }
+        if (categories[page_id] != UNTRACKED) {
+            auto& bucket = buckets[categories[page_id]];
+            PageID last = bucket.back();
+            bucket[positions[page_id]] = last;
+            positions[last] = positions[page_id];
+            bucket.pop_back();
+        }
+        categories[page_id] = category;
+        positions[page_id] = static_cast<uint32_t>(buckets[category].size());
+        buckets[category].push_back(page_id);
+    }
+
+    // A page with room for a record of `size` bytes, INVALID_PAGE_ID if the map has none.
+    // Prefers the fullest such page, and within a bucket the one updated last.
+    PageID find(size_t size) const {
+        for (size_t category = (size + FSM_CATEGORY_BYTES - 1) / FSM_CATEGORY_BYTES; category < NUM_CATEGORIES; ++category) {
+            if (!buckets[category].empty()) {
+                return buckets[category].back();
+            }
+        }
+        return INVALID_PAGE_ID;
+    }
+};
+
+// Copy-on-write holder for state that snapshots read while writers keep changing it.
+// share() hands out the current object, which is not modified again; the next write()
+// continues on a copy of it. Large per-node state keeps its data in shared chunks
+// (AdjacencyIndex, ChunkedArray), so that copy does not duplicate it.
+template <typename T>
+class Versioned {
+private:
+    std::shared_ptr<T> current = std::make_shared<T>();
+    bool shared = false;
+
+public:
+    Versioned() = default;
+    explicit Versioned(T value) : current(std::make_shared<T>(std::move(value))) {}
+
+    const T& operator*() const { return *current; }
+    const T* operator->() const { return current.get(); }
+
+    T& write() {
+        if (shared) {
+            current = std::make_shared<T>(*current);
+            shared = false;
+        }
+        return *current;
+    }
+
+    std::shared_ptr<const T> share() {
+        shared = true;
+        return current;
+    }
+};
+
+// Earlier states of records that were rewritten while snapshots were open, oldest first.
+// A version holds the record as snapshots taken before epoch `until` see it.
+template <typename Record>
+class RecordVersions {
+private:
+    struct Version {
+        uint64_t until;
+        Record record;
+    };
+    std::unordered_map<uint32_t, std::vector<Version>> versions;
+
+public:
+    // Keep `record` as it was before the mutation that completes epoch `until`
+    void save(uint64_t until, const Record& record) {
+        auto& chain = versions[record.id];
+        if (chain.empty() || chain.back().until != until) {
+            chain.push_back(Version{until, record});
+        }
+    }
+
+    // Record `id` as a snapshot at `epoch` sees it, nullptr if that is the stored record
+    const Record* find(uint32_t id, uint64_t epoch) const {
+        auto it = versions.find(id);
+        if (it == versions.end()) {
+            return nullptr;
+        }
+        for (const Version& version : it->second) {
+            if (version.until > epoch) {
+                return &version.record;
+            }
+        }
+        return nullptr;
+    }
+
+    // Drop the versions no snapshot at `oldest_epoch` or later can see
+    void collect(uint64_t oldest_epoch) {
+        for (auto it = versions.begin(); it != versions.end();) {
+            auto& chain = it->second;
+            chain.erase(chain.begin(), std::find_if(chain.begin(), chain.end(), [&](const Version& version) {
+                return version.until > oldest_epoch;
+            }));
+            it = chain.empty() ? versions.erase(it) : std::next(it);
+        }
+    }
+
+    bool empty() const {
+        return versions.empty();
+    }
+
+    size_t size() const {
+        size_t count = 0;
+        for (const auto& entry : versions) {
+            count += entry.second.size();
+        }
+        return count;
+    }
+};
+
+class GraphSnapshot;
+
+// One property assignment of a batch: `property` of node or edge `id` becomes `value`
+struct PropertyUpdate {
+    uint32_t id;
+    std::string property;
+    PropertyValue value;
+};
+
+// Mutations applied together by GraphManager::applyBatch, in this order
+struct GraphBatch {
+    std::vector<SNode> nodes; // New nodes, IDs assigned in order from getNextNodeId()
+    std::vector<SEdge> edges; // New edges, IDs assigned in order; may connect nodes of this batch
+    bool edges_directed = true;
+    std::vector<PropertyUpdate> node_updates; // May target nodes of this batch
+    std::vector<PropertyUpdate> edge_updates; // May target edges of this batch
+};
+
+class GraphManager {
+private:
+    friend class GraphSnapshot;
+
+    BufferManager& buffer_manager;
+
+    uint32_t next_node_id = 1;
+    uint32_t next_edge_id = 1;
+    std::vector<RecordID> node_directory = std::vector<RecordID>(1); // Node ID -> record location, entry 0 unused
+    std::vector<RecordID> edge_directory = std::vector<RecordID>(1); // Edge ID -> record location, entry 0 unused
+    FreeSpaceMap node_space; // Pages of node, dictionary and metadata records
+    FreeSpaceMap edge_space; // Pages of edge records
+    Versioned<AdjacencyIndex> adjacency; // Out-edges of every node
+    Versioned<AdjacencyIndex> reverse_adjacency; // In-edges of every node
+    PropertyKeyCatalog key_catalog; // Property name <-> key ID, persisted as KEY_RECORDs
+    StringDictionary string_dictionary; // Short string values <-> code, persisted as STRING_RECORDs
+    Versioned<LabelIndex> label_index; // Node labels, rebuilt from node records on open
+    std::shared_ptr<ThreadPool> traversal_pool; // Workers for parallel BFS levels, none when serial; shared with snapshots
+    std::vector<int64_t> like_contribution = std::vector<int64_t>(1); // Likes of a post node, 0 for other nodes
+    Versioned<ChunkedArray<int64_t>> authored_likes; // Sum of like_contribution over out-neighbors
+    std::unordered_map<std::string, std::pair<std::string, RecordID>> metadata; // Name -> value and its META_RECORD
+    std::unordered_map<std::string, PropertyIndex> node_indexes; // Property name -> B+-tree of node values
+    std::unordered_map<std::string, PropertyIndex> edge_indexes; // Property name -> B+-tree of edge values
+
+    // Mutations hold the state latch exclusively from start to end; snapshot reads of a
+    // record hold it shared while they read that one record. A waiting mutation keeps new
+    // reads out, so it waits for at most one record read per reading thread.
+    mutable WriterPreferringLatch state_latch;
+    std::atomic<std::thread::id> writer{}; // Thread inside a mutation; its nested mutations reuse the hold
+    uint64_t epoch = 0; // Mutations completed so far
+    mutable std::mutex snapshot_mutex;
+    mutable std::multiset<uint64_t> open_snapshots; // Epochs of the open snapshots, protected by snapshot_mutex
+    RecordVersions<SNode> node_versions; // Rewritten node records as open snapshots see them
+    RecordVersions<SEdge> edge_versions;
+
+    // Exclusive hold of the state latch for one public mutation. The epoch advances once
+    // the outermost mutation ends, so snapshots never see part of one.
+    class WriteScope {
+    private:
+        GraphManager& graph;
+        bool outermost;
+
+    public:
+        explicit WriteScope(GraphManager& graph)
+            : graph(graph), outermost(graph.writer.load() != std::this_thread::get_id()) {
+            if (outermost) {
+                graph.state_latch.lock();
+                graph.writer = std::this_thread::get_id();
+                graph.collectVersions();
+            }
+        }
+
+        WriteScope(const WriteScope&) = delete;
+        WriteScope& operator=(const WriteScope&) = delete;
+
+        ~WriteScope() {
+            if (outermost) {
+                graph.epoch++;
+                graph.writer = std::thread::id();
+                graph.state_latch.unlock();
+            }
+        }
+    };
+
+    // Keep the current state of a record this mutation rewrites if an open snapshot may read it
+    template <typename Record>
+    void preserveVersion(RecordVersions<Record>& versions, const Record& record) {
+        std::lock_guard<std::mutex> lock(snapshot_mutex);
+        if (!open_snapshots.empty()) {
+            versions.save(epoch + 1, record);
+        }
+    }
+
+    // Drop the record versions that no open snapshot can see any more
+    void collectVersions() {
+        if (node_versions.empty() && edge_versions.empty()) {
+            return;
+        }
+        uint64_t oldest_epoch;
+        {
+            std::lock_guard<std::mutex> lock(snapshot_mutex);
+            oldest_epoch = open_snapshots.empty() ? epoch : *open_snapshots.begin();
+        }
+        node_versions.collect(oldest_epoch);
+        edge_versions.collect(oldest_epoch);
+    }
+
+    // Whether record `id` existed at `snapshot_epoch`: it has a version kept for the
+    // snapshots at that epoch (it was rewritten or removed since), or it is still stored
+    template <typename Record>
+    bool existedAt(const RecordVersions<Record>& versions, const std::vector<RecordID>& directory,
+                   uint32_t id, uint64_t snapshot_epoch) const {
+        std::shared_lock<WriterPreferringLatch> lock(state_latch);
+        return versions.find(id, snapshot_epoch) != nullptr || directory[id].page_id != INVALID_PAGE_ID;
+    }
+
+    void closeSnapshot(uint64_t snapshot_epoch) const {
+        std::lock_guard<std::mutex> lock(snapshot_mutex);
+        open_snapshots.erase(open_snapshots.find(snapshot_epoch));
+    }
+
+    // Property name resolved once per query: record versions are matched by name, stored
+    // records by key ID
+    struct PropertyKey {
+        std::string name;
+        std::optional<uint16_t> key_id; // Unset if no stored record has the property
+    };
+
+    // String property `key` compared with a fixed list of values, resolved once per query
+    struct StringPredicate {
+        PropertyKey key;
+        std::vector<std::string> values;
+        std::vector<std::optional<uint32_t>> codes; // Dictionary code of each value, unset if no record holds it
+    };
+
+    PropertyKey resolveKey(const std::string& name) const {
+        std::shared_lock<WriterPreferringLatch> lock(state_latch);
+        return PropertyKey{name, key_catalog.lookup(name)};
+    }
+
+    StringPredicate resolveStringPredicate(const std::string& name, std::vector<std::string> values) const {
+        std::shared_lock<WriterPreferringLatch> lock(state_latch);
+        StringPredicate predicate{PropertyKey{name, key_catalog.lookup(name)}, std::move(values), {}};
+        for (const std::string& value : predicate.values) {
+            predicate.codes.push_back(string_dictionary.lookup(value));
+        }
+        return predicate;
+    }
+
+    // Property `key` of record `id` as a snapshot at `snapshot_epoch` sees it: the version
+    // kept for open snapshots if the record was rewritten since, otherwise the stored record
+    template <typename View, typename Record>
+    std::optional<PropertyValue> propertyAt(const RecordVersions<Record>& versions, const std::vector<RecordID>& directory,
+                                            uint32_t id, uint64_t snapshot_epoch, const PropertyKey& key) const {
+        std::shared_lock<WriterPreferringLatch> lock(state_latch);
+        if (const Record* record = versions.find(id, snapshot_epoch)) {
+            for (size_t i = 0; i < record->property_count; ++i) {
+                if (record->property_names[i] == key.name) {
+                    return record->property_values[i];
+                }
+            }
+            return std::nullopt;
+        }
+        if (!key.key_id.has_value() || directory[id].page_id == INVALID_PAGE_ID) {
+            return std::nullopt;
+        }
+        PageGuard page = buffer_manager.fix_page(directory[id].page_id);
+        return propertyOf(View(page->getRecord(directory[id].slot_id), &string_dictionary), *key.key_id);
+    }
+
+    // Position in `predicate.values` of the value record `id` holds as a snapshot at
+    // `snapshot_epoch` sees it, nullopt if it holds none of them. Stored records are matched
+    // by dictionary code without materializing the string.
+    template <typename View, typename Record>
+    std::optional<size_t> matchAt(const RecordVersions<Record>& versions, const std::vector<RecordID>& directory,
+                                  uint32_t id, uint64_t snapshot_epoch, const StringPredicate& predicate) const {
+        std::shared_lock<WriterPreferringLatch> lock(state_latch);
+        if (const Record* record = versions.find(id, snapshot_epoch)) {
+            for (size_t i = 0; i < record->property_count; ++i) {
+                const PropertyValue& value = record->property_values[i];
+                if (record->property_names[i] != predicate.key.name || value.type != STRING) {
+                    continue;
+                }
+                for (size_t v = 0; v < predicate.values.size(); ++v) {
+                    if (std::get<std::string>(value.value) == predicate.values[v]) {
+                        return v;
+                    }
+                }
+            }
+            return std::nullopt;
+        }
+        if (!predicate.key.key_id.has_value() || directory[id].page_id == INVALID_PAGE_ID) {
+            return std::nullopt;
+        }
+        PageGuard page = buffer_manager.fix_page(directory[id].page_id);
+        auto code = View(page->getRecord(directory[id].slot_id), &string_dictionary).stringCode(*predicate.key.key_id);
+        for (size_t v = 0; code.has_value() && v < predicate.codes.size(); ++v) {
+            if (predicate.codes[v] == code) {
+                return v;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Store a serialized record on the insert page of `space`, or else on a page its
+    // free-space map knows to have room, or else on a fresh page
+    RecordID insertRecord(const std::string& record, FreeSpaceMap& space) {
+        PageID page_id = space.insert_page != INVALID_PAGE_ID ? space.insert_page : space.find(record.size());
+        for (; page_id != INVALID_PAGE_ID; page_id = space.find(record.size())) {
+            PageGuard page = buffer_manager.fix_page(page_id, true);
+            auto slot = page.addRecord(record.data(), record.size());
+            space.update(page_id, page->freeSpace());
+            if (slot.has_value()) {
+                space.insert_page = page_id;
+                return RecordID{page_id, *slot};
+            }
+        }
+
+        space.insert_page = buffer_manager.allocatePage();
+        PageGuard page = buffer_manager.fix_page(space.insert_page, true);
+        auto slot = page.addRecord(record.data(), record.size());
+        if (!slot.has_value()) {
+            throw std::length_error("Record does not fit in an empty page");
+        }
+        space.update(space.insert_page, page->freeSpace());
+        return RecordID{space.insert_page, *slot};
+    }
+
+    // Store serialized records back to back, fixing each page once. Once the insert page is
+    // full the batch continues on pages with room, then on freshly allocated pages in order,
+    // so a batch into a full file is written as a sequential run of pages.
+    std::vector<RecordID> insertRecords(const std::vector<std::string>& records, FreeSpaceMap& space) {
+        std::vector<RecordID> locations;
+        locations.reserve(records.size());
+
+        size_t next = 0;
+        while (next < records.size()) {
+            PageID page_id = space.insert_page;
+            if (page_id == INVALID_PAGE_ID) {
+                page_id = space.find(records[next].size());
+            }
+            bool fresh = page_id == INVALID_PAGE_ID;
+            if (fresh) {
+                page_id = buffer_manager.allocatePage();
+            }
+            PageGuard page = buffer_manager.fix_page(page_id, true);
+            size_t first = next;
+            for (; next < records.size(); ++next) {
+                auto slot = page.addRecord(records[next].data(), records[next].size());
+                if (!slot.has_value()) {
+                    break;
+                }
+                locations.push_back(RecordID{page_id, *slot});
+            }
+            space.update(page_id, page->freeSpace());
+            if (next == first && fresh) {
+                throw std::length_error("Record does not fit in an empty page");
+            }
+            // Full, continue elsewhere
+            space.insert_page = next < records.size() ? INVALID_PAGE_ID : page_id;
+        }
+        return locations;
+    }
+
+    // Overwrite a record in place, relocating it if it no longer fits in its page. A moved
+    // record is stored before its old copy is freed, so a failure leaves the old one.
+    RecordID updateRecord(RecordID record_id, const std::string& record, FreeSpaceMap& space) {
+        {
+            PageGuard page = buffer_manager.fix_page(record_id.page_id, true);
+            bool updated = page.updateRecord(record_id.slot_id, record.data(), record.size());
+            space.update(record_id.page_id, page->freeSpace());
+            if (updated) {
+                return record_id;
+            }
+        }
+        RecordID moved = insertRecord(record, space);
+        freeRecord(record_id, space);
+        return moved;
+    }
+
+    // Overwrite many records, fixing each page once in page order. Records that no longer
+    // fit in their page move elsewhere in `space`, and their old copies are freed once every
+    // moved record is stored. Returns the new locations in input order.
+    std::vector<RecordID> updateRecords(const std::vector<RecordID>& locations, const std::vector<std::string>& records, FreeSpaceMap& space) {
+        std::vector<size_t> order(locations.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return std::tie(locations[a].page_id, locations[a].slot_id) < std::tie(locations[b].page_id, locations[b].slot_id);
+        });
+
+        std::vector<RecordID> updated = locations;
+        std::vector<size_t> moved;
+        for (size_t next = 0; next < order.size();) {
+            PageID page_id = locations[order[next]].page_id;
+            PageGuard page = buffer_manager.fix_page(page_id, true);
+            for (; next < order.size() && locations[order[next]].page_id == page_id; ++next) {
+                size_t i = order[next];
+                if (!page.updateRecord(locations[i].slot_id, records[i].data(), records[i].size())) {
+                    moved.push_back(i);
+                }
+            }
+            space.update(page_id, page->freeSpace());
+        }
+
+        std::vector<std::string> moved_records;
+        for (size_t i : moved) {
+            moved_records.push_back(records[i]);
+        }
+        std::vector<RecordID> moved_locations = insertRecords(moved_records, space);
+        for (size_t j = 0; j < moved.size(); ++j) {
+            updated[moved[j]] = moved_locations[j];
+        }
+        for (size_t i : moved) {
+            freeRecord(locations[i], space); // In page order, as `moved` is
+        }
+        return updated;
+    }
+
+    // Size of `record` once serialized. String values that internStrings would code take a
+    // directory entry only; the others are also stored after the directory.
+    template <typename Record>
+    size_t encodedSize(const Record& record) const {
+        size_t size = sizeof(RecordHeader) + sizeof(uint8_t) + record.property_count * PROPERTY_ENTRY_SIZE;
+        if constexpr (std::is_same_v<Record, SEdge>) {
+            size += 2 * sizeof(uint32_t); // Source and target
+        }
+        for (size_t i = 0; i < record.property_count; ++i) {
+            const PropertyValue& value = record.property_values[i];
+            if (value.type != STRING) {
+                continue;
+            }
+            const std::string& str = std::get<std::string>(value.value);
+            bool encode = str.size() <= MAX_DICTIONARY_STRING_LENGTH || record.property_names[i] == LABEL_PROPERTY;
+            if (!encode && !string_dictionary.lookup(str).has_value()) {
+                size += sizeof(uint16_t) + str.size();
+            }
+        }
+        return size;
+    }
+
+    // Reject a record no page can hold, before anything has been changed for it
+    template <typename Record>
+    void checkRecordSize(const Record& record) const {
+        if (encodedSize(record) > MAX_RECORD_SIZE) {
+            throw std::length_error("Record does not fit in an empty page");
+        }
+    }
+
+    // Give every property name a key ID and every short string value a dictionary code,
+    // persisting new entries before the record that references them
+    template <typename Record>
+    void internStrings(const Record& record) {
+        for (size_t i = 0; i < record.property_count; ++i) {
+            const std::string& name = record.property_names[i];
+            if (!key_catalog.lookup(name).has_value()) {
+                uint16_t key_id = key_catalog.add(name);
+                insertRecord(encodeDictionaryRecord(KEY_RECORD, key_id, name), node_space);
+            }
+
+            const PropertyValue& value = record.property_values[i];
+            if (value.type != STRING) {
+                continue;
+            }
+            // Labels are always coded so the label index can refer to them
+            const std::string& str = std::get<std::string>(value.value);
+            bool encode = str.size() <= MAX_DICTIONARY_STRING_LENGTH || name == LABEL_PROPERTY;
+            if (encode && !string_dictionary.lookup(str).has_value()) {
+                uint32_t code = string_dictionary.add(str);
+                insertRecord(encodeDictionaryRecord(STRING_RECORD, code, str), node_space);
+            }
+        }
+    }
+
+    // Grow the per-node structures to cover `node_id`
+    void ensureNodeState(uint32_t node_id) {
+        if (adjacency->numNodes() < node_id) {
+            adjacency.write().ensureNode(node_id);
+            reverse_adjacency.write().ensureNode(node_id);
+        }
+        if (authored_likes->size() <= node_id) {
+            authored_likes.write().resize(node_id + 1);
+            like_contribution.resize(node_id + 1, 0);
+        }
+    }
+
+    // Register source -> target in both adjacency directions and the like aggregates
+    void indexEdge(uint32_t source, uint32_t target, uint32_t edge_id) {
+        ensureNodeState(std::max(source, target));
+        bool inserted = adjacency.write().addEdge(source, target, edge_id);
+        reverse_adjacency.write().addEdge(target, source, edge_id);
+        if (inserted && like_contribution[target] != 0) {
+            authored_likes.write().mutableAt(source) += like_contribution[target];
+        }
+    }
+
+    // Bulk version of indexEdge: one sorted merge per adjacency direction
+    void indexEdges(const std::vector<BatchEdge>& batch) {
+        std::vector<BatchEdge> reversed;
+        reversed.reserve(batch.size());
+        for (const BatchEdge& edge : batch) {
+            ensureNodeState(std::max(edge.source, edge.target));
+            reversed.push_back(BatchEdge{edge.target, edge.source, edge.edge_id});
+        }
+        std::vector<bool> inserted = adjacency.write().addEdges(batch);
+        reverse_adjacency.write().addEdges(reversed);
+        auto& likes = authored_likes.write();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (inserted[i]) {
+                likes.mutableAt(batch[i].source) += like_contribution[batch[i].target];
+            }
+        }
+    }
+
+    // Undo indexEdge for source -> target, unless the pair has been overwritten by another edge
+    void unindexEdge(uint32_t source, uint32_t target, uint32_t edge_id) {
+        if (adjacency->findEdge(source, target) != edge_id) {
+            return;
+        }
+        adjacency.write().removeEdge(source, target);
+        reverse_adjacency.write().removeEdge(target, source);
+        if (like_contribution[target] != 0) {
+            authored_likes.write().mutableAt(source) -= like_contribution[target];
+        }
+    }
+
+    // Whether an adjacency entry still refers to edge `edge_id` between `source` and `target`
+    bool edgeIndexed(uint32_t edge_id, uint32_t source, uint32_t target, bool is_directed) const {
+        return adjacency->findEdge(source, target) == edge_id ||
+               (!is_directed && adjacency->findEdge(target, source) == edge_id);
+    }
+
+    // Edges stored for source -> target (and target -> source if undirected) that a new edge
+    // between the two would overwrite in the adjacency index
+    void collectOverwritten(uint32_t source, uint32_t target, bool is_directed, std::vector<uint32_t>& edge_ids) const {
+        if (auto edge_id = adjacency->findEdge(source, target)) {
+            edge_ids.push_back(*edge_id);
+        }
+        if (auto edge_id = adjacency->findEdge(target, source); edge_id && !is_directed) {
+            edge_ids.push_back(*edge_id);
+        }
+    }
+
+    // Remove the edges among `edge_ids` that newer edges for the same pairs have displaced
+    // from every adjacency entry, so no edge record outlives its place in the index (where
+    // removeNode looks for the edges of a node)
+    void removeDisplacedEdges(std::vector<uint32_t> edge_ids) {
+        std::sort(edge_ids.begin(), edge_ids.end());
+        edge_ids.erase(std::unique(edge_ids.begin(), edge_ids.end()), edge_ids.end());
+        for (uint32_t edge_id : edge_ids) {
+            bool indexed;
+            {
+                auto edge = viewEdge(edge_id);
+                indexed = edgeIndexed(edge_id, edge->source(), edge->target(), edge->isDirected());
+            }
+            if (!indexed) {
+                removeEdge(edge_id);
+            }
+        }
+    }
+
+    void freeRecord(RecordID record_id, FreeSpaceMap& space) {
+        PageGuard page = buffer_manager.fix_page(record_id.page_id, true);
+        page.deleteRecord(record_id.slot_id);
+        space.update(record_id.page_id, page->freeSpace());
+    }
+
+    // Free the slot of a removed record and leave a tombstone in its directory entry
+    void deleteStoredRecord(std::vector<RecordID>& directory, uint32_t id, FreeSpaceMap& space) {
+        RecordID record_id = directory[id];
+        directory[id] = RecordID();
+        freeRecord(record_id, space);
+    }
+
+    // Recompute what a node adds to its in-neighbors' like totals and push the difference
+    void refreshLikeContribution(uint32_t node_id) {
+        int64_t contribution = 0;
+        auto likes_key = key_catalog.lookup(LIKES_PROPERTY);
+        auto post_code = string_dictionary.lookup(POST_LABEL);
+        if (likes_key && post_code && label_index->labelOf(node_id) == *post_code) {
+            contribution = viewNode(node_id)->getInt(*likes_key).value_or(0);
+        }
+
+        int64_t delta = contribution - like_contribution[node_id];
+        if (delta == 0) {
+            return;
+        }
+        like_contribution[node_id] = contribution;
+        auto& likes = authored_likes.write();
+        reverse_adjacency->forEachNeighbor(node_id, [&](uint32_t author, uint32_t) {
+            likes.mutableAt(author) += delta;
+        });
+    }
+
+    template <typename T>
+    static void setDirectoryEntry(std::vector<T>& directory, uint32_t id, const T& value) {
+        if (directory.size() <= id) {
+            directory.resize(id + 1);
+        }
+        directory[id] = value;
+    }
+
+    // Rebuild directories, key catalog and adjacency index by scanning every page
+    void loadFromStorage() {
+        // One front-to-back pass over the file, then back to point lookups
+        AccessAdvice previous_advice = buffer_manager.getAccessAdvice();
+        buffer_manager.adviseAccess(AccessAdvice::SEQUENTIAL);
+
+        std::vector<uint32_t> node_records;
+        std::vector<std::pair<BatchEdge, bool>> edges; // Stored edges and whether they are directed
+        for (PageID page_id = 0; page_id < buffer_manager.getNumPages(); ++page_id) {
+            PageGuard page = buffer_manager.fix_page(page_id);
+            FreeSpaceMap* space = &node_space; // Index pages are in neither map
+            for (uint16_t slot = 0; slot < MAX_SLOTS; ++slot) {
+                const char* record = page->getRecord(slot);
+                if (record == nullptr) {
+                    continue;
+                }
+                RecordView view(record, sizeof(RecordHeader));
+                RecordHeader header = view.header();
+                RecordID record_id{page_id, slot};
+
+                switch (header.kind) {
+                    case NODE_RECORD:
+                        setDirectoryEntry(node_directory, header.id, record_id);
+                        next_node_id = std::max(next_node_id, header.id + 1);
+                        ensureNodeState(header.id);
+                        node_records.push_back(header.id);
+                        break;
+                    case EDGE_RECORD: {
+                        EdgeView edge(record);
+                        setDirectoryEntry(edge_directory, header.id, record_id);
+                        next_edge_id = std::max(next_edge_id, header.id + 1);
+                        edges.emplace_back(BatchEdge{edge.source(), edge.target(), header.id}, edge.isDirected());
+                        space = space != nullptr ? &edge_space : nullptr;
+                        break;
+                    }
+                    case KEY_RECORD:
+                        key_catalog.add(static_cast<uint16_t>(header.id),
+                                        std::string(record + sizeof(RecordHeader), header.length - sizeof(RecordHeader)));
+                        break;
+                    case STRING_RECORD:
+                        string_dictionary.add(header.id,
+                                              std::string(record + sizeof(RecordHeader), header.length - sizeof(RecordHeader)));
+                        break;
+                    case META_RECORD: {
+                        std::string_view payload(record + sizeof(RecordHeader), header.length - sizeof(RecordHeader));
+                        size_t separator = payload.find('\0');
+                        metadata[std::string(payload.substr(0, separator))] = {std::string(payload.substr(separator + 1)), record_id};
+                        break;
+                    }
+                    default:
+                        space = nullptr;
+                        break; // Not a graph record
+                }
+            }
+            if (space != nullptr) {
+                space->update(page_id, page->freeSpace());
+            }
+        }
+        buffer_manager.adviseAccess(previous_advice);
+
+        // IDs of removed records are not handed out again
+        for (auto [name, next_id] : {std::pair{&NEXT_NODE_ID_METADATA, &next_node_id}, std::pair{&NEXT_EDGE_ID_METADATA, &next_edge_id}}) {
+            if (auto value = getMetadata(*name)) {
+                *next_id = std::max(*next_id, static_cast<uint32_t>(std::stoul(*value)));
+            }
+        }
+        node_directory.resize(next_node_id);
+        edge_directory.resize(next_edge_id);
+        ensureNodeState(next_node_id - 1);
+
+        // Edges of removed nodes, left by files written before createEdge replaced the edge
+        // of an existing pair, stay out of the index; opening never rewrites the file
+        std::vector<BatchEdge> batch;
+        for (const auto& [edge, is_directed] : edges) {
+            if (!isNode(edge.source) || !isNode(edge.target)) {
+                continue;
+            }
+            batch.push_back(edge);
+            if (!is_directed) {
+                batch.push_back(BatchEdge{edge.target, edge.source, edge.edge_id});
+            }
+        }
+        indexEdges(batch);
+
+        // Labels and likes need the key catalog and dictionary, which may sit on later pages
+        for (uint32_t node_id : node_records) {
+            updateLabel(*viewNode(node_id));
+        }
+        for (uint32_t node_id : node_records) {
+            refreshLikeContribution(node_id);
+        }
+    }
+
+    void updateLabel(const NodeView& node) {
+        auto label_key = key_catalog.lookup(LABEL_PROPERTY);
+        auto label = label_key ? node.stringCode(*label_key) : std::nullopt;
+        label_index.write().setLabel(node.id(), label.value_or(NO_LABEL));
+    }
+
+    // Reattach the property indexes recorded in the metadata
+    void openIndexes() {
+        for (const auto& [name, entry] : metadata) {
+            for (auto [prefix, indexes] : {std::pair{&NODE_INDEX_METADATA, &node_indexes}, std::pair{&EDGE_INDEX_METADATA, &edge_indexes}}) {
+                if (name.compare(0, prefix->size(), *prefix) == 0) {
+                    PageID root = static_cast<PageID>(std::stoul(entry.first));
+                    indexes->emplace(name.substr(prefix->size()), PropertyIndex(BTreeIndex(buffer_manager, root)));
+                }
+            }
+        }
+    }
+
+    // Create a persistent index of `property` and fill it from records 1 .. next_id - 1,
+    // reading their values with read(id, key_id)
+    template <typename Read>
+    PropertyIndex& buildIndex(std::unordered_map<std::string, PropertyIndex>& indexes, const std::string& metadata_prefix,
+                              const std::string& property, uint32_t next_id, Read read) {
+        PropertyIndex index(BTreeIndex::create(buffer_manager));
+        setMetadata(metadata_prefix + property, std::to_string(index.rootPage()));
+        if (auto key_id = key_catalog.lookup(property)) {
+            for (uint32_t id = 1; id < next_id; ++id) {
+                if (auto value = read(id, *key_id)) {
+                    index.insert(*value, id);
+                }
+            }
+        }
+        return indexes.emplace(property, index).first->second;
+    }
+
+    // Index of a node property, created on first use for INDEXED_NODE_PROPERTIES and filled
+    // from the stored nodes below `backfill_end` (all of them by default); nullptr if the
+    // property is not indexed
+    PropertyIndex* nodeIndex(const std::string& property, std::optional<uint32_t> backfill_end = std::nullopt) {
+        auto it = node_indexes.find(property);
+        if (it != node_indexes.end()) {
+            return &it->second;
+        }
+        if (std::find(INDEXED_NODE_PROPERTIES.begin(), INDEXED_NODE_PROPERTIES.end(), property) == INDEXED_NODE_PROPERTIES.end()) {
+            return nullptr;
+        }
+        return &buildIndex(node_indexes, NODE_INDEX_METADATA, property, backfill_end.value_or(next_node_id),
+                           [this](uint32_t id, uint16_t key_id) { return nodeProperty(id, key_id); });
+    }
+
+    PropertyIndex* indexFor(const SNode&, const std::string& property, std::optional<uint32_t> backfill_end = std::nullopt) {
+        return nodeIndex(property, backfill_end);
+    }
+
+    PropertyIndex* indexFor(const SEdge&, const std::string& property, std::optional<uint32_t> = std::nullopt) {
+        auto it = edge_indexes.find(property);
+        return it != edge_indexes.end() ? &it->second : nullptr;
+    }
+
+    // Add the indexed properties of a freshly stored node or edge to their indexes. An index
+    // created on the way is backfilled from the older records only, so this one goes in once.
+    template <typename Record>
+    void indexProperties(const Record& record) {
+        for (size_t i = 0; i < record.property_count; ++i) {
+            if (PropertyIndex* index = indexFor(record, record.property_names[i], record.id)) {
+                index->insert(record.property_values[i], record.id);
+            }
+        }
+    }
+
+    // Remove the indexed properties of a node or edge that is being removed
+    template <typename Record>
+    void unindexProperties(const Record& record) {
+        for (size_t i = 0; i < record.property_count; ++i) {
+            if (PropertyIndex* index = indexFor(record, record.property_names[i])) {
+                index->erase(record.property_values[i], record.id);
+            }
+        }
+    }
+
+    // Bulk version for records with consecutive IDs: entries go in per property in value
+    // order, so inserts walk the leaves in order. Only indexed properties are collected.
+    template <typename Record>
+    void indexProperties(const std::vector<Record>& records) {
+        std::map<std::string, std::pair<PropertyIndex*, std::vector<std::pair<PropertyValue, uint32_t>>>> entries;
+        for (const Record& record : records) {
+            for (size_t i = 0; i < record.property_count; ++i) {
+                auto it = entries.find(record.property_names[i]);
+                if (it == entries.end()) {
+                    PropertyIndex* index = indexFor(record, record.property_names[i], records.front().id);
+                    it = entries.emplace(record.property_names[i], std::pair{index, std::vector<std::pair<PropertyValue, uint32_t>>()}).first;
+                }
+                if (it->second.first != nullptr) {
+                    it->second.second.emplace_back(record.property_values[i], record.id);
+                }
+            }
+        }
+        for (auto& [property, entry] : entries) {
+            auto& [index, values] = entry;
+            std::sort(values.begin(), values.end());
+            for (const auto& [value, id] : values) {
+                index->insert(value, id);
+            }
+        }
+    }
+
+    // Move a record within the index of `property` once its value changes from what
+    // `before` holds to `value`
+    template <typename Record>
+    void reindexProperty(const Record& before, const std::string& property, const PropertyValue& value) {
+        PropertyIndex* index = indexFor(before, property);
+        if (index == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i < before.property_count; ++i) {
+            if (before.property_names[i] == property) {
+                index->erase(before.property_values[i], before.id);
+            }
+        }
+        index->insert(value, before.id);
+    }
+
+    template <typename View>
+    static std::optional<PropertyValue> propertyOf(const View& view, uint16_t key_id) {
+        auto index = view.findProperty(key_id);
+        if (!index.has_value()) {
+            return std::nullopt;
+        }
+        return view.propertyValue(*index);
+    }
+
+    // Property of a stored node, nullopt if it lacks the property or has been removed
+    std::optional<PropertyValue> nodeProperty(uint32_t node_id, uint16_t key_id) const {
+        if (!isNode(node_id)) {
+            return std::nullopt;
+        }
+        return propertyOf(*viewNode(node_id), key_id);
+    }
+
+    std::optional<PropertyValue> edgeProperty(uint32_t edge_id, uint16_t key_id) const {
+        if (!isEdge(edge_id)) {
+            return std::nullopt;
+        }
+        return propertyOf(*viewEdge(edge_id), key_id);
+    }
+
+    // IDs of the stored records in `directory` satisfying every predicate, ascending. Indexed
+    // predicates are answered from their indexes and intersected; the others are checked on
+    // the records of the remaining candidates through read(id, key_id).
+    template <typename Read>
+    std::vector<uint32_t> evaluate(const std::unordered_map<std::string, PropertyIndex>& indexes,
+                                   const std::vector<PropertyPredicate>& predicates, const std::vector<RecordID>& directory,
+                                   Read read) const {
+        std::optional<std::vector<uint32_t>> candidates;
+        std::vector<const PropertyPredicate*> residual;
+        for (const PropertyPredicate& predicate : predicates) {
+            auto it = indexes.find(predicate.property);
+            if (it == indexes.end()) {
+                residual.push_back(&predicate);
+                continue;
+            }
+            if (predicate.needsRecheck()) {
+                residual.push_back(&predicate);
+            }
+            std::vector<uint32_t> ids = it->second.find(predicate);
+            std::sort(ids.begin(), ids.end());
+            if (candidates.has_value()) {
+                std::vector<uint32_t> both;
+                std::set_intersection(candidates->begin(), candidates->end(), ids.begin(), ids.end(), std::back_inserter(both));
+                ids = std::move(both);
+            }
+            candidates = std::move(ids);
+        }
+
+        if (!candidates.has_value()) {
+            candidates.emplace();
+            for (uint32_t id = 1; id < directory.size(); ++id) {
+                if (directory[id].page_id != INVALID_PAGE_ID) {
+                    candidates->push_back(id);
+                }
+            }
+        }
+        for (const PropertyPredicate* predicate : residual) {
+            auto key_id = key_catalog.lookup(predicate->property);
+            if (!key_id.has_value()) {
+                return {}; // No record has the property
+            }
+            candidates->erase(std::remove_if(candidates->begin(), candidates->end(), [&](uint32_t id) {
+                auto value = read(id, *key_id);
+                return !value.has_value() || !predicate->matches(*value);
+            }), candidates->end());
+        }
+        return std::move(*candidates);
+    }
+
+    // Whether a node is stored, i.e. has been created and not removed
+    bool isNode(uint32_t node_id) const {
+        return node_id >= 1 && node_id < node_directory.size() && node_directory[node_id].page_id != INVALID_PAGE_ID;
+    }
+
+    bool isEdge(uint32_t edge_id) const {
+        return edge_id >= 1 && edge_id < edge_directory.size() && edge_directory[edge_id].page_id != INVALID_PAGE_ID;
+    }
+
+public:
+    GraphManager(BufferManager& bm) : buffer_manager(bm) {
+        loadFromStorage();
+        openIndexes();
+    }
+
+    uint32_t createNode(const std::unordered_map<std::string, PropertyValue>& properties) {
+        WriteScope scope(*this);
+        SNode node(next_node_id);
         for (const auto& [key, value] : properties) {
-            std::cout << key << ": ";
-            value.print();
-            std::cout << ", ";
+            node.addProperty(key, value);
+        }
+        checkRecordSize(node);
+
+        uint32_t id = next_node_id++;
+        ensureNodeState(id);
+
+        internStrings(node);
+        node_directory.push_back(insertRecord(node.serialize(key_catalog, string_dictionary), node_space));
+        updateLabel(*viewNode(id));
+        refreshLikeContribution(id);
+        indexProperties(node);
+        return id;
+    }
+
+    bool addNodeProperty(uint32_t node_id, const std::string& property_name, const PropertyValue& value) {
+        WriteScope scope(*this);
+        if (!isNode(node_id)) {
+            std::cerr << "Node ID does not exist.\n";
+            return false;
+        }
+
+        SNode node = getNode(node_id);
+        SNode updated = node;
+        updated.addProperty(property_name, value);
+        checkRecordSize(updated);
+        preserveVersion(node_versions, node);
+        reindexProperty(node, property_name, value);
+        internStrings(updated);
+        node_directory[node_id] = updateRecord(node_directory[node_id], updated.serialize(key_catalog, string_dictionary), node_space);
+        if (property_name == LABEL_PROPERTY) {
+            updateLabel(*viewNode(node_id));
+        }
+        if (property_name == LABEL_PROPERTY || property_name == LIKES_PROPERTY) {
+            refreshLikeContribution(node_id);
+        }
+        return true;
+    }
+
+    uint32_t createEdge(uint32_t source, uint32_t target, const std::unordered_map<std::string, PropertyValue>& properties, bool is_directed = true) {
+        WriteScope scope(*this);
+        if (!isNode(source) || !isNode(target)) {
+            throw std::out_of_range("Source or target node ID does not exist");
+        }
+
+        SEdge edge(next_edge_id, source, target);
+        for (const auto& [key, value] : properties) {
+            edge.addProperty(key, value);
+        }
+        checkRecordSize(edge);
+        uint32_t id = next_edge_id++;
+
+        internStrings(edge);
+        edge_directory.push_back(insertRecord(edge.serialize(key_catalog, string_dictionary, is_directed), edge_space));
+        indexProperties(edge);
+
+        // An existing edge between the same nodes is replaced
+        std::vector<uint32_t> overwritten;
+        collectOverwritten(source, target, is_directed, overwritten);
+        indexEdge(source, target, id);
+        if (!is_directed) {
+            indexEdge(target, source, id);
+        }
+        removeDisplacedEdges(std::move(overwritten));
+        return id;
+    }
+
+    // Bulk-load path for many new nodes. IDs are assigned consecutively in vector order
+    // (the IDs passed in are ignored) and the first one is returned. Records are packed
+    // into pages in ID order, and labels and likes are taken from the nodes themselves
+    // rather than read back from the pages.
+    uint32_t createNodes(std::vector<SNode> nodes) {
+        WriteScope scope(*this);
+        for (const SNode& node : nodes) {
+            checkRecordSize(node);
+        }
+        uint32_t first_id = next_node_id;
+        std::vector<std::string> records;
+        records.reserve(nodes.size());
+        for (SNode& node : nodes) {
+            node.id = next_node_id++;
+            internStrings(node);
+        }
+        for (const SNode& node : nodes) {
+            records.push_back(node.serialize(key_catalog, string_dictionary));
+        }
+        ensureNodeState(next_node_id - 1);
+        for (RecordID record_id : insertRecords(records, node_space)) {
+            node_directory.push_back(record_id);
+        }
+
+        // A new node has no in-edges yet, so its likes only need recording
+        auto post_code = string_dictionary.lookup(POST_LABEL);
+        for (const SNode& node : nodes) {
+            uint32_t label = NO_LABEL;
+            int64_t likes = 0;
+            for (size_t i = 0; i < node.property_count; ++i) {
+                const PropertyValue& value = node.property_values[i];
+                if (node.property_names[i] == LABEL_PROPERTY && value.type == STRING) {
+                    label = string_dictionary.lookup(std::get<std::string>(value.value)).value_or(NO_LABEL);
+                } else if (node.property_names[i] == LIKES_PROPERTY && value.type == INT) {
+                    likes = std::get<int>(value.value);
+                }
+            }
+            label_index.write().setLabel(node.id, label);
+            if (post_code && label == *post_code) {
+                like_contribution[node.id] = likes;
+            }
+        }
+        indexProperties(nodes);
+        return first_id;
+    }
+
+    // Bulk-load path for many new edges, all directed or all undirected. IDs are assigned
+    // like createNodes; the adjacency indexes take the whole batch in one merge. Edges
+    // between the same nodes replace existing ones and earlier ones in the batch, like
+    // repeated createEdge calls. Throws before changing anything if an endpoint does not exist.
+    uint32_t createEdges(std::vector<SEdge> edges, bool is_directed = true) {
+        WriteScope scope(*this);
+        for (const SEdge& edge : edges) {
+            if (!isNode(edge.source) || !isNode(edge.target)) {
+                throw std::out_of_range("Source or target node ID does not exist");
+            }
+            checkRecordSize(edge);
+        }
+
+        uint32_t first_id = next_edge_id;
+        std::vector<std::string> records;
+        std::vector<BatchEdge> batch;
+        records.reserve(edges.size());
+        batch.reserve(is_directed ? edges.size() : 2 * edges.size());
+        for (SEdge& edge : edges) {
+            edge.id = next_edge_id++;
+            internStrings(edge);
+        }
+        for (const SEdge& edge : edges) {
+            records.push_back(edge.serialize(key_catalog, string_dictionary, is_directed));
+            batch.push_back(BatchEdge{edge.source, edge.target, edge.id});
+            if (!is_directed) {
+                batch.push_back(BatchEdge{edge.target, edge.source, edge.id});
+            }
+        }
+        for (RecordID record_id : insertRecords(records, edge_space)) {
+            edge_directory.push_back(record_id);
+        }
+        std::vector<uint32_t> overwritten;
+        for (const SEdge& edge : edges) {
+            collectOverwritten(edge.source, edge.target, is_directed, overwritten);
+        }
+        indexEdges(batch);
+        indexProperties(edges);
+        for (const SEdge& edge : edges) {
+            if (!edgeIndexed(edge.id, edge.source, edge.target, is_directed)) {
+                overwritten.push_back(edge.id); // Repeated later in the batch
+            }
+        }
+        removeDisplacedEdges(std::move(overwritten));
+        return first_id;
+    }
+
+    bool addEdgeProperty(uint32_t edge_id, const std::string& property_name, const PropertyValue& value) {
+        WriteScope scope(*this);
+        if (!isEdge(edge_id)) {
+            std::cerr << "Edge ID does not exist.\n";
+            return false;
+        }
+
+        bool is_directed = viewEdge(edge_id)->isDirected();
+        SEdge edge = getEdge(edge_id);
+        SEdge updated = edge;
+        updated.addProperty(property_name, value);
+        checkRecordSize(updated);
+        preserveVersion(edge_versions, edge);
+        reindexProperty(edge, property_name, value);
+        internStrings(updated);
+        edge_directory[edge_id] = updateRecord(edge_directory[edge_id], updated.serialize(key_catalog, string_dictionary, is_directed), edge_space);
+        return true;
+    }
+
+    // Delete an edge: its record, its entries in both adjacency directions and in the
+    // property indexes. Returns false if the edge does not exist.
+    bool removeEdge(uint32_t edge_id) {
+        WriteScope scope(*this);
+        if (!isEdge(edge_id)) {
+            std::cerr << "Edge ID does not exist.\n";
+            return false;
+        }
+
+        bool is_directed = viewEdge(edge_id)->isDirected();
+        SEdge edge = getEdge(edge_id);
+        preserveVersion(edge_versions, edge);
+        unindexProperties(edge);
+        unindexEdge(edge.source, edge.target, edge_id);
+        if (!is_directed) {
+            unindexEdge(edge.target, edge.source, edge_id);
+        }
+        deleteStoredRecord(edge_directory, edge_id, edge_space);
+        if (edge_id + 1 == next_edge_id) {
+            setMetadata(NEXT_EDGE_ID_METADATA, std::to_string(next_edge_id));
+        }
+        return true;
+    }
+
+    // Delete a node together with every edge into or out of it. Returns false if the node
+    // does not exist.
+    bool removeNode(uint32_t node_id) {
+        WriteScope scope(*this);
+        if (!isNode(node_id)) {
+            std::cerr << "Node ID does not exist.\n";
+            return false;
+        }
+
+        std::set<uint32_t> edges; // An undirected edge shows up in both directions
+        adjacency->forEachNeighbor(node_id, [&](uint32_t, uint32_t edge_id) { edges.insert(edge_id); });
+        reverse_adjacency->forEachNeighbor(node_id, [&](uint32_t, uint32_t edge_id) { edges.insert(edge_id); });
+        for (uint32_t edge_id : edges) {
+            removeEdge(edge_id);
+        }
+
+        SNode node = getNode(node_id);
+        preserveVersion(node_versions, node);
+        unindexProperties(node);
+        label_index.write().setLabel(node_id, NO_LABEL);
+        like_contribution[node_id] = 0;
+        deleteStoredRecord(node_directory, node_id, node_space);
+        if (node_id + 1 == next_node_id) {
+            setMetadata(NEXT_NODE_ID_METADATA, std::to_string(next_node_id));
+        }
+        return true;
+    }
+
+    // Apply a batch of mutations with one commit. New nodes and edges go through
+    // createNodes and createEdges; property updates are merged per record, and the
+    // rewritten records are stored with one fix per page in page order. Throws before
+    // changing anything if an ID does not exist once the batch's own records are counted,
+    // if an update targets an edge that an edge of the batch replaces, or if an updated
+    // record would not fit in a page.
+    void applyBatch(GraphBatch batch) {
+        WriteScope scope(*this);
+        uint32_t last_node = next_node_id + static_cast<uint32_t>(batch.nodes.size());
+        uint32_t last_edge = next_edge_id + static_cast<uint32_t>(batch.edges.size());
+        auto node_exists = [&](uint32_t id) { return isNode(id) || (id >= next_node_id && id < last_node); };
+        auto edge_exists = [&](uint32_t id) { return isEdge(id) || (id >= next_edge_id && id < last_edge); };
+        for (const SEdge& edge : batch.edges) {
+            if (!node_exists(edge.source) || !node_exists(edge.target)) {
+                throw std::out_of_range("Source or target node ID does not exist");
+            }
+        }
+        for (const PropertyUpdate& update : batch.node_updates) {
+            if (!node_exists(update.id)) {
+                throw std::out_of_range("Node ID does not exist");
+            }
+        }
+        for (const PropertyUpdate& update : batch.edge_updates) {
+            if (!edge_exists(update.id)) {
+                throw std::out_of_range("Edge ID does not exist");
+            }
+        }
+
+        // Records the updates start from, and the updated records, whose sizes are checked
+        // now; records of the batch's own nodes and edges are taken from the batch
+        std::map<uint32_t, SNode> nodes;
+        std::map<uint32_t, SNode> updated_nodes;
+        for (const PropertyUpdate& update : batch.node_updates) {
+            auto it = nodes.find(update.id);
+            if (it == nodes.end()) {
+                SNode node = isNode(update.id) ? getNode(update.id) : batch.nodes[update.id - next_node_id];
+                node.id = update.id;
+                it = nodes.emplace(update.id, node).first;
+                updated_nodes.emplace(update.id, node);
+            }
+            updated_nodes.at(update.id).addProperty(update.property, update.value);
+        }
+        // Node pairs the batch's edges take over, each mapped to the last edge for it
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> pair_edges;
+        for (size_t i = 0; i < batch.edges.size(); ++i) {
+            uint32_t edge_id = next_edge_id + static_cast<uint32_t>(i);
+            pair_edges[{batch.edges[i].source, batch.edges[i].target}] = edge_id;
+            if (!batch.edges_directed) {
+                pair_edges[{batch.edges[i].target, batch.edges[i].source}] = edge_id;
+            }
+        }
+        auto indexed_after = [&](uint32_t edge_id, uint32_t source, uint32_t target) {
+            auto it = pair_edges.find({source, target});
+            return it != pair_edges.end() ? it->second == edge_id : adjacency->findEdge(source, target) == edge_id;
+        };
+
+        std::map<uint32_t, std::pair<SEdge, bool>> edges; // Edge -> record and whether it is directed
+        std::map<uint32_t, SEdge> updated_edges;
+        for (const PropertyUpdate& update : batch.edge_updates) {
+            auto it = edges.find(update.id);
+            if (it == edges.end()) {
+                bool stored = isEdge(update.id);
+                SEdge edge = stored ? getEdge(update.id) : batch.edges[update.id - next_edge_id];
+                edge.id = update.id;
+                bool is_directed = stored ? viewEdge(update.id)->isDirected() : batch.edges_directed;
+                // createEdges removes an edge once the batch has replaced it in every direction
+                if (!indexed_after(update.id, edge.source, edge.target) &&
+                    (is_directed || !indexed_after(update.id, edge.target, edge.source))) {
+                    throw std::out_of_range("Edge ID is replaced by an edge of the batch");
+                }
+                it = edges.emplace(update.id, std::pair{edge, is_directed}).first;
+                updated_edges.emplace(update.id, edge);
+            }
+            updated_edges.at(update.id).addProperty(update.property, update.value);
+        }
+        for (const auto& [node_id, node] : updated_nodes) {
+            checkRecordSize(node);
+        }
+        for (const auto& [edge_id, edge] : updated_edges) {
+            checkRecordSize(edge);
+        }
+
+        if (!batch.nodes.empty()) {
+            createNodes(std::move(batch.nodes));
+        }
+        if (!batch.edges.empty()) {
+            createEdges(std::move(batch.edges), batch.edges_directed);
+        }
+
+        // Apply the updates of each record in order, then rewrite it once
+        std::unordered_set<uint32_t> relabeled, reliked;
+        for (auto& [node_id, node] : nodes) {
+            preserveVersion(node_versions, node);
+        }
+        for (const PropertyUpdate& update : batch.node_updates) {
+            SNode& node = nodes.at(update.id);
+            reindexProperty(node, update.property, update.value);
+            node.addProperty(update.property, update.value);
+            if (update.property == LABEL_PROPERTY) {
+                relabeled.insert(update.id);
+            }
+            if (update.property == LABEL_PROPERTY || update.property == LIKES_PROPERTY) {
+                reliked.insert(update.id);
+            }
+        }
+        for (auto& [edge_id, edge] : edges) {
+            preserveVersion(edge_versions, edge.first);
+        }
+        for (const PropertyUpdate& update : batch.edge_updates) {
+            SEdge& edge = edges.at(update.id).first;
+            reindexProperty(edge, update.property, update.value);
+            edge.addProperty(update.property, update.value);
+        }
+
+        // Intern first: new dictionary entries are inserted while no page is fixed
+        std::vector<RecordID> locations;
+        std::vector<std::string> records;
+        for (const auto& [node_id, node] : nodes) {
+            internStrings(node);
+        }
+        for (const auto& [node_id, node] : nodes) {
+            locations.push_back(node_directory[node_id]);
+            records.push_back(node.serialize(key_catalog, string_dictionary));
+        }
+        locations = updateRecords(locations, records, node_space);
+        auto node_location = locations.begin();
+        for (const auto& entry : nodes) {
+            node_directory[entry.first] = *node_location++;
+        }
+
+        locations.clear();
+        records.clear();
+        for (const auto& [edge_id, edge] : edges) {
+            internStrings(edge.first);
+        }
+        for (const auto& [edge_id, edge] : edges) {
+            locations.push_back(edge_directory[edge_id]);
+            records.push_back(edge.first.serialize(key_catalog, string_dictionary, edge.second));
+        }
+        locations = updateRecords(locations, records, edge_space);
+        auto edge_location = locations.begin();
+        for (const auto& entry : edges) {
+            edge_directory[entry.first] = *edge_location++;
+        }
+
+        for (uint32_t node_id : relabeled) {
+            updateLabel(*viewNode(node_id));
+        }
+        for (uint32_t node_id : reliked) {
+            refreshLikeContribution(node_id);
+        }
+        commit();
+    }
+
+    uint32_t getNextNodeId() const {
+        return next_node_id;
+    }
+
+    uint32_t getNextEdgeId() const {
+        return next_edge_id;
+    }
+
+    // Record versions currently kept for open snapshots
+    size_t getNumRecordVersions() const {
+        return node_versions.size() + edge_versions.size();
+    }
+
+    // Persist a named database-level value, replacing any previous value
+    void setMetadata(const std::string& name, const std::string& value) {
+        WriteScope scope(*this);
+        std::string record = encodeMetadataRecord(name, value);
+        auto it = metadata.find(name);
+        if (it != metadata.end()) {
+            it->second = {value, updateRecord(it->second.second, record, node_space)};
+        } else {
+            metadata[name] = {value, insertRecord(record, node_space)};
+        }
+    }
+
+    std::optional<std::string> getMetadata(const std::string& name) const {
+        auto it = metadata.find(name);
+        if (it == metadata.end()) {
+            return std::nullopt;
+        }
+        return it->second.first;
+    }
+
+    // Make every change so far durable: once this returns, reopening the database
+    // after a crash recovers them from the write-ahead log
+    void commit() {
+        buffer_manager.commit();
+    }
+
+    // Index `property` of all nodes, existing ones included, so predicates on it are answered
+    // from the index. Indexes persist with the database; creating one again does nothing.
+    void createNodeIndex(const std::string& property) {
+        WriteScope scope(*this);
+        if (node_indexes.count(property) == 0) {
+            buildIndex(node_indexes, NODE_INDEX_METADATA, property, next_node_id,
+                       [this](uint32_t id, uint16_t key_id) { return nodeProperty(id, key_id); });
+        }
+    }
+
+    void createEdgeIndex(const std::string& property) {
+        WriteScope scope(*this);
+        if (edge_indexes.count(property) == 0) {
+            buildIndex(edge_indexes, EDGE_INDEX_METADATA, property, next_edge_id,
+                       [this](uint32_t id, uint16_t key_id) { return edgeProperty(id, key_id); });
+        }
+    }
+
+    bool hasNodeIndex(const std::string& property) const {
+        return node_indexes.count(property) != 0;
+    }
+
+    bool hasEdgeIndex(const std::string& property) const {
+        return edge_indexes.count(property) != 0;
+    }
+
+    // Nodes satisfying every predicate, in node ID order, e.g.
+    // {between("age", 25, 30), equals("location", "Chicago")}
+    std::vector<uint32_t> findNodes(const std::vector<PropertyPredicate>& predicates) const {
+        return evaluate(node_indexes, predicates, node_directory,
+                        [this](uint32_t id, uint16_t key_id) { return nodeProperty(id, key_id); });
+    }
+
+    // Nodes whose `property` equals `value`, in node ID order
+    std::vector<uint32_t> findNodes(const std::string& property, const PropertyValue& value) const {
+        return findNodes({PropertyPredicate::equals(property, value)});
+    }
+
+    // Edges satisfying every predicate, in edge ID order
+    std::vector<uint32_t> findEdges(const std::vector<PropertyPredicate>& predicates) const {
+        return evaluate(edge_indexes, predicates, edge_directory,
+                        [this](uint32_t id, uint16_t key_id) { return edgeProperty(id, key_id); });
+    }
+
+    // Nodes whose string `property` starts with `prefix`, in value order if indexed
+    std::vector<uint32_t> findNodesWithPrefix(const std::string& property, const std::string& prefix) const {
+        auto it = node_indexes.find(property);
+        if (it != node_indexes.end() && prefix.size() <= MAX_INDEX_STRING_LENGTH) {
+            return it->second.findStringPrefix(prefix);
+        }
+        std::vector<uint32_t> candidates;
+        if (it != node_indexes.end()) {
+            candidates = it->second.findStringPrefix(prefix.substr(0, MAX_INDEX_STRING_LENGTH));
+        } else {
+            candidates.resize(next_node_id - 1);
+            std::iota(candidates.begin(), candidates.end(), 1);
+        }
+        auto key_id = key_catalog.lookup(property);
+        if (!key_id.has_value()) {
+            return {};
+        }
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t node_id) {
+            auto value = nodeProperty(node_id, *key_id);
+            return !value || value->type != STRING || std::get<std::string>(value->value).compare(0, prefix.size(), prefix) != 0;
+        }), candidates.end());
+        return candidates;
+    }
+
+    // Zero-copy view of a node record; its page stays pinned while the view lives
+    PinnedView<NodeView> viewNode(uint32_t node_id) const {
+        if (!isNode(node_id)) {
+            throw std::out_of_range("Node ID does not exist");
+        }
+        RecordID record_id = node_directory[node_id];
+        PageGuard page = buffer_manager.fix_page(record_id.page_id);
+        NodeView view(page->getRecord(record_id.slot_id), &string_dictionary);
+        return PinnedView<NodeView>(std::move(page), view);
+    }
+
+    // Zero-copy view of an edge record; its page stays pinned while the view lives
+    PinnedView<EdgeView> viewEdge(uint32_t edge_id) const {
+        if (!isEdge(edge_id)) {
+            throw std::out_of_range("Edge ID does not exist");
+        }
+        RecordID record_id = edge_directory[edge_id];
+        PageGuard page = buffer_manager.fix_page(record_id.page_id);
+        EdgeView view(page->getRecord(record_id.slot_id), &string_dictionary);
+        return PinnedView<EdgeView>(std::move(page), view);
+    }
+
+    // Decode the stored record of a node
+    SNode getNode(uint32_t node_id) const {
+        return viewNode(node_id)->materialize(key_catalog);
+    }
+
+    // Decode the stored record of an edge
+    SEdge getEdge(uint32_t edge_id) const {
+        return viewEdge(edge_id)->materialize(key_catalog);
+    }
+
+    const PropertyKeyCatalog& getKeyCatalog() const {
+        return key_catalog;
+    }
+
+    const StringDictionary& getStringDictionary() const {
+        return string_dictionary;
+    }
+
+    // BFS engine over the current adjacency indexes, shared by all hop-limited traversals
+    BfsEngine traversal(BfsMode mode = BfsMode::AUTO) const {
+        return BfsEngine(*adjacency, *reverse_adjacency, next_node_id - 1, mode, traversal_pool.get());
+    }
+
+    // Number of threads used per traversal level, 1 runs traversals serially. Open
+    // snapshots keep the pool they were taken with.
+    void setTraversalThreads(size_t num_threads) {
+        WriteScope scope(*this);
+        traversal_pool = num_threads > 1 ? std::make_shared<ThreadPool>(num_threads) : nullptr;
+    }
+
+    // Total likes over the posts a node points to, maintained as posts and edges change
+    int64_t getAuthoredLikes(uint32_t node_id) const {
+        if (!isNode(node_id)) {
+            throw std::out_of_range("Node ID does not exist");
+        }
+        return (*authored_likes)[node_id];
+    }
+
+    // Nodes whose `type` is `label`, answered from the label index without page reads
+    Bitmap getNodesWithLabel(const std::string& label) const {
+        auto code = string_dictionary.lookup(label);
+        return label_index->nodesWithLabel(code.value_or(NO_LABEL));
+    }
+
+    // Start asynchronous reads of the pages holding these nodes' records
+    void prefetchNodes(const std::vector<uint32_t>& node_ids) {
+        std::vector<PageID> pages;
+        for (uint32_t node_id : node_ids) {
+            if (isNode(node_id)) {
+                pages.push_back(node_directory[node_id].page_id);
+            }
+        }
+        buffer_manager.prefetch(std::move(pages));
+    }
+
+    RecordID getNodeLocation(uint32_t node_id) const {
+        if (!isNode(node_id)) {
+            throw std::out_of_range("Node ID does not exist");
+        }
+        return node_directory[node_id];
+    }
+
+    // Consistent view of the graph as it is now, for queries that must not see (or block)
+    // later mutations. Must not be called inside a mutation.
+    GraphSnapshot snapshot();
+
+    // The queries below each run on a snapshot of their own
+    std::vector<size_t> findNthDegreeConnections(size_t start_node, size_t degree);
+
+    // Shortest chain of edges from `source` to `target` using at most `max_hops` edges
+    std::optional<GraphPath> shortestPath(uint32_t source, uint32_t target, size_t max_hops);
+
+    std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> findConnectionsAndLikes(uint32_t user_id);
+
+    void printNodes() const {
+        std::unordered_set<size_t> nodes; // Use a set to ensure unique nodes
+        std::cout << "Nodes in the graph:\n";
+
+        for (uint32_t i = 1; i <= adjacency->numNodes(); ++i) {
+            adjacency->forEachNeighbor(i, [&](uint32_t j, uint32_t) {
+                nodes.insert(i); // Add source node
+                nodes.insert(j); // Add target node
+            });
+        }
+
+        // Print all unique nodes with their details
+        for (size_t node_id : nodes) {
+            getNode(node_id).print(); // Use the node's print function
+        }
+    }
+
+    void printEdges() const {
+        std::cout << "Edges in the graph:\n";
+        std::unordered_set<std::pair<size_t, size_t>, pair_hash> processed_edges;
+
+        for (uint32_t i = 1; i <= adjacency->numNodes(); ++i) {
+            adjacency->forEachNeighbor(i, [&](uint32_t j, uint32_t) {
+                // Ensure (i, j) is processed only once
+                auto edge = (i < j) ? std::pair<size_t, size_t>(i, j) : std::pair<size_t, size_t>(j, i);
+                if (processed_edges.find(edge) == processed_edges.end()) {
+                    std::cout << "Edge: " << i << " -> " << j;
+                    if (adjacency->findEdge(j, i)) {
+                        std::cout << " (Undirected)";
+                    }
+                    std::cout << "\n";
+                    processed_edges.insert(edge);
+                }
+            });
+        }
+    }
+};
+
+// Consistent read-only view of a graph as of one epoch. Adjacency, labels and likes are
+// the copy-on-write versions current when the snapshot was taken; node and edge
+// properties come from the stored records, or from the versions the graph keeps for open
+// snapshots when a record has been rewritten since. A writer waits only for the record
+// reads in progress when it arrives, one per reading thread (possibly a page miss), since
+// later reads queue behind it; writers never wait for a query to finish. A snapshot
+// may be used from another thread than the graph's writer, one thread at a time, and
+// must be closed before the graph is destroyed. The property indexes are not versioned:
+// GraphManager::findNodes and the B+-tree lookups behind it see the current graph.
+class GraphSnapshot {
+private:
+    const GraphManager* graph;
+    uint64_t epoch;
+    uint32_t next_node_id;
+    uint32_t next_edge_id;
+    std::shared_ptr<const AdjacencyIndex> adjacency;
+    std::shared_ptr<const AdjacencyIndex> reverse_adjacency;
+    std::shared_ptr<const LabelIndex> label_index;
+    std::shared_ptr<const ChunkedArray<int64_t>> authored_likes;
+    std::shared_ptr<ThreadPool> traversal_pool;
+
+    // Start asynchronous reads of the pages holding these records
+    void prefetch(const std::vector<uint32_t>& node_ids, const std::vector<uint32_t>& edge_ids) const {
+        std::vector<PageID> pages;
+        {
+            std::shared_lock<WriterPreferringLatch> lock(graph->state_latch);
+            for (uint32_t node_id : node_ids) {
+                pages.push_back(graph->node_directory[node_id].page_id);
+            }
+            for (uint32_t edge_id : edge_ids) {
+                pages.push_back(graph->edge_directory[edge_id].page_id);
+            }
+        }
+        graph->buffer_manager.prefetch(std::move(pages));
+    }
+
+public:
+    GraphSnapshot(GraphManager& graph, uint64_t epoch)
+        : graph(&graph), epoch(epoch), next_node_id(graph.next_node_id), next_edge_id(graph.next_edge_id),
+          adjacency(graph.adjacency.share()), reverse_adjacency(graph.reverse_adjacency.share()),
+          label_index(graph.label_index.share()), authored_likes(graph.authored_likes.share()),
+          traversal_pool(graph.traversal_pool) {}
+
+    GraphSnapshot(const GraphSnapshot&) = delete;
+    GraphSnapshot& operator=(const GraphSnapshot&) = delete;
+
+    GraphSnapshot(GraphSnapshot&& other) noexcept
+        : graph(other.graph), epoch(other.epoch), next_node_id(other.next_node_id), next_edge_id(other.next_edge_id),
+          adjacency(std::move(other.adjacency)), reverse_adjacency(std::move(other.reverse_adjacency)),
+          label_index(std::move(other.label_index)), authored_likes(std::move(other.authored_likes)),
+          traversal_pool(std::move(other.traversal_pool)) {
+        other.graph = nullptr;
+    }
+
+    GraphSnapshot& operator=(GraphSnapshot&&) = delete;
+
+    ~GraphSnapshot() {
+        if (graph != nullptr) {
+            graph->closeSnapshot(epoch);
+        }
+    }
+
+    uint64_t getEpoch() const {
+        return epoch;
+    }
+
+    bool isNode(uint32_t node_id) const {
+        return node_id >= 1 && node_id < next_node_id &&
+               graph->existedAt(graph->node_versions, graph->node_directory, node_id, epoch);
+    }
+
+    bool isEdge(uint32_t edge_id) const {
+        return edge_id >= 1 && edge_id < next_edge_id &&
+               graph->existedAt(graph->edge_versions, graph->edge_directory, edge_id, epoch);
+    }
+
+    uint32_t getNextNodeId() const {
+        return next_node_id;
+    }
+
+    uint32_t getNextEdgeId() const {
+        return next_edge_id;
+    }
+
+    BfsEngine traversal(BfsMode mode = BfsMode::AUTO) const {
+        return BfsEngine(*adjacency, *reverse_adjacency, next_node_id - 1, mode, traversal_pool.get());
+    }
+
+    const AdjacencyIndex& outEdges() const {
+        return *adjacency;
+    }
+
+    int64_t getAuthoredLikes(uint32_t node_id) const {
+        if (!isNode(node_id)) {
+            throw std::out_of_range("Node ID does not exist");
+        }
+        return (*authored_likes)[node_id];
+    }
+
+    Bitmap getNodesWithLabel(const std::string& label) const {
+        decltype(graph->string_dictionary.lookup(label)) code;
+        {
+            std::shared_lock<WriterPreferringLatch> lock(graph->state_latch);
+            code = graph->string_dictionary.lookup(label);
         }
-        std::cout << "]\n";
+        return label_index->nodesWithLabel(code.value_or(NO_LABEL));
+    }
+
+    std::optional<PropertyValue> getNodeProperty(uint32_t node_id, const std::string& name) const {
+        if (!isNode(node_id)) {
+            throw std::out_of_range("Node ID does not exist");
+        }
+        return graph->propertyAt<NodeView>(graph->node_versions, graph->node_directory, node_id, epoch,
+                                           graph->resolveKey(name));
+    }
+
+    std::optional<PropertyValue> getEdgeProperty(uint32_t edge_id, const std::string& name) const {
+        if (!isEdge(edge_id)) {
+            throw std::out_of_range("Edge ID does not exist");
+        }
+        return graph->propertyAt<EdgeView>(graph->edge_versions, graph->edge_directory, edge_id, epoch,
+                                           graph->resolveKey(name));
+    }
+
+    std::vector<size_t> findNthDegreeConnections(size_t start_node, size_t degree) const {
+        if (start_node < 1 || start_node >= next_node_id) {
+            throw std::out_of_range("Start node is out of range");
+        }
+
+        if (degree == 0) {
+            throw std::invalid_argument("Degree must be greater than 0");
+        }
+
+        std::vector<size_t> nth_degree_connections;
+        Bitmap users = getNodesWithLabel("user");
+
+        traversal().run(start_node, degree, [&](size_t depth, const std::vector<uint32_t>& frontier) {
+            if (depth == degree) {
+                std::vector<uint32_t> found;
+                for (uint32_t node : frontier) {
+                    if (users.test(node)) {
+                        nth_degree_connections.push_back(node);
+                        found.push_back(node);
+                    }
+                }
+                // Callers materialize the result nodes next; read their pages in parallel now
+                prefetch(found, {});
+            }
+            return true;
+        });
+
+        return nth_degree_connections;
+    }
+
+    // Shortest chain of edges from `source` to `target` using at most `max_hops` edges
+    std::optional<GraphPath> shortestPath(uint32_t source, uint32_t target, size_t max_hops) const {
+        if (!isNode(source) || !isNode(target)) {
+            throw std::out_of_range("Source or target node ID does not exist");
+        }
+        return traversal().shortestPath(source, target, max_hops);
+    }
+
+    std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> findConnectionsAndLikes(uint32_t user_id) const {
+        if (user_id < 1 || user_id >= next_node_id) {
+            throw std::out_of_range("User ID is out of range");
+        }
+
+        std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> result = {
+            {"colleagues", {}},
+            {"friends", {}}
+        };
+
+        Bitmap users = getNodesWithLabel("user");
+        auto name_key = graph->resolveKey("name");
+        auto relationship = graph->resolveStringPredicate("relationship", {"colleagues", "friends"});
+
+        // Issue reads for every neighbor and edge record page at once
+        std::vector<uint32_t> neighbors, edges;
+        adjacency->forEachNeighbor(user_id, [&](uint32_t neighbor, uint32_t edge_id) {
+            if (users.test(neighbor)) {
+                neighbors.push_back(neighbor);
+                edges.push_back(edge_id);
+            }
+        });
+        prefetch(neighbors, edges);
+
+        // Traverse the adjacency index
+        for (size_t i = 0; i < neighbors.size(); ++i) {
+            // Retrieve neighbor node details
+            auto name = graph->propertyAt<NodeView>(graph->node_versions, graph->node_directory, neighbors[i], epoch,
+                                                    name_key);
+            if (!name || name->type != STRING) {
+                continue;
+            }
+
+            // Retrieve the edge details
+            auto match = graph->matchAt<EdgeView>(graph->edge_versions, graph->edge_directory, edges[i], epoch,
+                                                  relationship);
+            if (!match.has_value()) {
+                continue;
+            }
+
+            // Likes on posts created by this neighbor
+            int likes = static_cast<int>((*authored_likes)[neighbors[i]]);
+
+            // Add to the result based on the relationship type
+            result[relationship.values[*match]].push_back({std::get<std::string>(name->value), likes});
+        }
+
+        return result;
     }
 };
 
-class SEdge {
+inline GraphSnapshot GraphManager::snapshot() {
+    assert(writer.load() != std::this_thread::get_id() && "snapshot taken inside a mutation");
+    std::unique_lock<WriterPreferringLatch> lock(state_latch);
+    {
+        std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex);
+        open_snapshots.insert(epoch);
+    }
+    return GraphSnapshot(*this, epoch);
+}
+
+inline std::vector<size_t> GraphManager::findNthDegreeConnections(size_t start_node, size_t degree) {
+    return snapshot().findNthDegreeConnections(start_node, degree);
+}
+
+inline std::optional<GraphPath> GraphManager::shortestPath(uint32_t source, uint32_t target, size_t max_hops) {
+    return snapshot().shortestPath(source, target, max_hops);
+}
+
+inline std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> GraphManager::findConnectionsAndLikes(uint32_t user_id) {
+    return snapshot().findConnectionsAndLikes(user_id);
+}
+
+// Whole file mapped read-only, so the loader can tokenize it in place.
+// A missing or empty file reads as empty contents.
+class MappedFile {
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+
 public:
-    uint32_t id;
-    uint32_t source;
-    uint32_t target;
-    std::array<std::string, MaxPropertyCount> property_names;
-    std::array<PropertyValue, MaxPropertyCount> property_values;
-    size_t property_count = 0;
+    explicit MappedFile(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Cannot open " << filename << ": " << std::strerror(errno) << "\n";
+            return;
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+            void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                std::cerr << "Cannot map " << filename << ": " << std::strerror(errno) << "\n";
+                exit(-1);
+            }
+            madvise(mapping, file_stat.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapping);
+            size = file_stat.st_size;
+        }
+        ::close(fd);
+    }
 
-    SEdge(uint32_t id, uint32_t source, uint32_t target) : id(id), source(source), target(target) {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
 
-    void addProperty(const std::string& name, const PropertyValue& value) {
-        if (property_count >= MaxPropertyCount) {
-            throw std::overflow_error("Maximum property count reached");
+    ~MappedFile() {
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), size);
         }
-        property_names[property_count] = name;
-        property_values[property_count] = value;
-        property_count++;
     }
 
-    Edge convert() const {
-        Edge edge(id, source, target);
-        for (size_t i = 0; i < property_count; ++i) {
-            edge.addProperty(property_names[i], property_values[i]);
+    std::string_view contents() const {
+        return std::string_view(data, size);
+    }
+};
+
+// Zero-copy CSV tokenizer: rows and fields are views into the underlying text.
+// Fields are split on commas without quoting, which is all the data files use.
+class CsvTokenizer {
+private:
+    std::string_view rest;
+
+public:
+    explicit CsvTokenizer(std::string_view text) : rest(text) {}
+
+    // Next non-empty row without its line ending, false at the end of the text
+    bool nextRow(std::string_view& row) {
+        while (!rest.empty()) {
+            size_t end = rest.find('\n');
+            row = rest.substr(0, end);
+            rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+            if (!row.empty() && row.back() == '\r') {
+                row.remove_suffix(1);
+            }
+            if (!row.empty()) {
+                return true;
+            }
         }
-        return edge;
+        return false;
     }
 
-    void print() const {
-        std::cout << "Edge " << id << " (" << source << " -> " << target << ") [ ";
-        for (size_t i = 0; i < property_count; ++i) {
-            std::cout << property_names[i] << ": ";
-            property_values[i].print();
-            std::cout << ", ";
+    // Split off the next field of `row`; the last field takes the rest of the row
+    static std::string_view nextField(std::string_view& row) {
+        size_t end = row.find(',');
+        std::string_view field = row.substr(0, end);
+        row.remove_prefix(end == std::string_view::npos ? row.size() : end + 1);
+        return field;
+    }
+
+    static int parseInt(std::string_view field) {
+        int value = 0;
+        auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (error != std::errc() || end != field.data() + field.size()) {
+            throw std::invalid_argument("Malformed integer in CSV: " + std::string(field));
         }
-        std::cout << "]\n";
+        return value;
     }
 };
 
-enum class GraphType {
-    DIRECTED,
-    UNDIRECTED
+// Cut `text` into about `num_chunks` pieces that each end on a line boundary
+std::vector<std::string_view> splitLines(std::string_view text, size_t num_chunks) {
+    std::vector<std::string_view> chunks;
+    size_t target = std::max<size_t>(text.size() / std::max<size_t>(num_chunks, 1), 1);
+    while (!text.empty()) {
+        size_t end = text.find('\n', std::min(target, text.size()) - 1);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+        chunks.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return chunks;
+}
+
+// Parse every row after the header with parse_row(fields), chunks in parallel.
+// Rows come back in file order so IDs assigned from them do not depend on the split.
+template <typename Row, typename ParseRow>
+std::vector<Row> parseCsv(const MappedFile& file, ThreadPool& pool, ParseRow parse_row) {
+    std::string_view text = file.contents();
+    size_t header_end = text.find('\n');
+    text.remove_prefix(header_end == std::string_view::npos ? text.size() : header_end + 1);
+
+    std::vector<std::string_view> chunks = splitLines(text, pool.size() * 4);
+    std::vector<std::vector<Row>> parsed(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    pool.parallelFor(chunks.size(), 1, [&](size_t, size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            try {
+                CsvTokenizer tokenizer(chunks[chunk]);
+                std::string_view row;
+                while (tokenizer.nextRow(row)) {
+                    parsed[chunk].push_back(parse_row(row));
+                }
+            } catch (...) {
+                errors[chunk] = std::current_exception();
+            }
+        }
+    });
+
+    std::vector<Row> rows;
+    for (size_t chunk = 0; chunk < chunks.size(); ++chunk) {
+        if (errors[chunk]) {
+            std::rethrow_exception(errors[chunk]);
+        }
+        rows.insert(rows.end(), parsed[chunk].begin(), parsed[chunk].end());
+    }
+    return rows;
+}
+
+struct UserRow {
+    int user_id;
+    std::string_view name;
+    int age;
+    std::string_view location;
 };
 
-static constexpr size_t MAX_NODES = 180;
+struct ConnectionRow {
+    int source;
+    int target;
+    std::string_view relationship;
+};
 
-class GraphManager {
-private:
-    BufferManager& buffer_manager;
+struct PostRow {
+    int user_id;
+    int post_id;
+    std::string_view content;
+    int likes;
+};
+
+// Load users, connections and posts with the bulk node/edge paths. Node IDs come out
+// as users in file order, then posts in file order. Returns user name -> node ID.
+std::unordered_map<std::string, uint32_t> bulkLoadGraph(GraphManager& graph_manager,
+                                                        const std::string& users_filename,
+                                                        const std::string& connections_filename,
+                                                        const std::string& posts_filename,
+                                                        size_t num_threads = std::thread::hardware_concurrency()) {
+    ThreadPool pool(num_threads);
+    MappedFile users_file(users_filename);
+    MappedFile connections_file(connections_filename);
+    MappedFile posts_file(posts_filename);
+
+    auto users = parseCsv<UserRow>(users_file, pool, [](std::string_view row) {
+        UserRow user;
+        user.user_id = CsvTokenizer::parseInt(CsvTokenizer::nextField(row));
+        user.name = CsvTokenizer::nextField(row);
+        user.age = CsvTokenizer::parseInt(CsvTokenizer::nextField(row));
+        user.location = CsvTokenizer::nextField(row);
+        return user;
+    });
+    auto connections = parseCsv<ConnectionRow>(connections_file, pool, [](std::string_view row) {
+        ConnectionRow connection;
+        connection.source = CsvTokenizer::parseInt(CsvTokenizer::nextField(row));
+        connection.target = CsvTokenizer::parseInt(CsvTokenizer::nextField(row));
+        connection.relationship = CsvTokenizer::nextField(row);
+        return connection;
+    });
+    auto posts = parseCsv<PostRow>(posts_file, pool, [](std::string_view row) {
+        PostRow post;
+        post.user_id = CsvTokenizer::parseInt(CsvTokenizer::nextField(row));
+        post.post_id = CsvTokenizer::parseInt(CsvTokenizer::nextField(row));
+        post.content = CsvTokenizer::nextField(row);
+        post.likes = CsvTokenizer::parseInt(CsvTokenizer::nextField(row));
+        return post;
+    });
+
+    std::unordered_map<uint32_t, uint32_t> user_id_to_node_id;
+    std::unordered_map<std::string, uint32_t> name_to_node_id;
+    // Unknown user IDs map to 0. Edge rows that reference one are skipped and counted
+    // instead of failing the whole load.
+    size_t skipped_rows = 0;
+    auto userNode = [&](int user_id) {
+        auto it = user_id_to_node_id.find(user_id);
+        return it != user_id_to_node_id.end() ? it->second : 0;
+    };
+
+    // Step 1: users
+    std::vector<SNode> user_nodes;
+    user_nodes.reserve(users.size());
+    for (const UserRow& user : users) {
+        SNode node(0);
+        node.addProperty("type", PropertyValue("user"));
+        node.addProperty("user_id", PropertyValue(user.user_id));
+        node.addProperty("name", PropertyValue(std::string(user.name)));
+        node.addProperty("age", PropertyValue(user.age));
+        node.addProperty("location", PropertyValue(std::string(user.location)));
+        user_nodes.push_back(std::move(node));
+    }
+    uint32_t node_id = graph_manager.createNodes(std::move(user_nodes));
+    for (const UserRow& user : users) {
+        user_id_to_node_id[user.user_id] = node_id;
+        name_to_node_id[std::string(user.name)] = node_id;
+        node_id++;
+    }
+
+    // Step 2: connections, undirected
+    std::vector<SEdge> connection_edges;
+    connection_edges.reserve(connections.size());
+    for (const ConnectionRow& connection : connections) {
+        uint32_t source = userNode(connection.source);
+        uint32_t target = userNode(connection.target);
+        if (source == 0 || target == 0) {
+            skipped_rows++;
+            continue;
+        }
+        SEdge edge(0, source, target);
+        edge.addProperty("relationship", PropertyValue(std::string(connection.relationship)));
+        connection_edges.push_back(std::move(edge));
+    }
+    graph_manager.createEdges(std::move(connection_edges), false);
+
+    // Step 3: posts and the user -> post edges
+    std::vector<SNode> post_nodes;
+    post_nodes.reserve(posts.size());
+    for (const PostRow& post : posts) {
+        SNode node(0);
+        node.addProperty("type", PropertyValue("post"));
+        node.addProperty("post_id", PropertyValue(post.post_id));
+        node.addProperty("content", PropertyValue(std::string(post.content)));
+        node.addProperty("likes", PropertyValue(post.likes));
+        post_nodes.push_back(std::move(node));
+    }
+    uint32_t post_node_id = graph_manager.createNodes(std::move(post_nodes));
+
+    std::vector<SEdge> posted_edges;
+    posted_edges.reserve(posts.size());
+    for (const PostRow& post : posts) {
+        uint32_t author = userNode(post.user_id);
+        uint32_t post_node = post_node_id++;
+        if (author == 0) {
+            skipped_rows++;
+            continue;
+        }
+        SEdge edge(0, author, post_node);
+        edge.addProperty("label", PropertyValue("posted"));
+        posted_edges.push_back(std::move(edge));
+    }
+    graph_manager.createEdges(std::move(posted_edges));
+
+    if (skipped_rows > 0) {
+        std::cerr << "Skipped " << skipped_rows << " edges with an unknown user_id\n";
+    }
+
+    return name_to_node_id;
+}
+
+// The CSV files a graph is loaded from
+struct CsvSources {
+    std::string users = "users.csv";
+    std::string connections = "connections.csv";
+    std::string posts = "posts.csv";
+
+    // Size and modification time of each file; a stored graph is current if it was
+    // loaded while the files had the same fingerprint
+    std::string fingerprint() const {
+        std::string result;
+        for (const std::string* filename : {&users, &connections, &posts}) {
+            struct stat file_stat;
+            result += *filename;
+            if (stat(filename->c_str(), &file_stat) == 0) {
+                result += ":" + std::to_string(file_stat.st_size) + ":" +
+                          std::to_string(file_stat.st_mtim.tv_sec) + "." + std::to_string(file_stat.st_mtim.tv_nsec);
+            }
+            result += ";";
+        }
+        return result;
+    }
+};
+
+const std::string CSV_SOURCE_METADATA = "csv_source"; // Fingerprint of the CSVs the stored graph came from
+
+// Graph built from the CSV files, kept open so queries only pay for the query.
+// Members are declared so the graph manager is destroyed before its buffer manager.
+struct LoadedGraph {
+    std::unique_ptr<BufferManager> buffer_manager;
+    std::unique_ptr<GraphManager> graph_manager;
+
+    // Node of the user called `name` through the persistent name index. Like the loader's
+    // name map, the user loaded last wins if names repeat.
+    std::optional<uint32_t> findUser(const std::string& name) const {
+        std::vector<uint32_t> node_ids = graph_manager->findNodes("name", PropertyValue(name));
+        if (node_ids.empty()) {
+            return std::nullopt;
+        }
+        return node_ids.back();
+    }
+
+    // Open the graph stored in the database file, or return nullptr if the file was
+    // not loaded from the current CSVs (missing, overwritten, or the CSVs changed)
+    static std::unique_ptr<LoadedGraph> reopen(const CsvSources& sources = CsvSources()) {
+        auto graph = std::make_unique<LoadedGraph>();
+        graph->buffer_manager = std::make_unique<BufferManager>(false);
+        graph->graph_manager = std::make_unique<GraphManager>(*graph->buffer_manager);
+        if (graph->graph_manager->getMetadata(CSV_SOURCE_METADATA) != sources.fingerprint()) {
+            return nullptr;
+        }
+        return graph;
+    }
+
+    // Truncate the database file and load it from the CSVs. The loaded graph is
+    // checkpointed before the fingerprint is stored, so the flusher or an eviction cannot
+    // write the fingerprint ahead of the data, and an interrupted load is redone next time.
+    static std::unique_ptr<LoadedGraph> populate(const CsvSources& sources = CsvSources()) {
+        auto graph = std::make_unique<LoadedGraph>();
+        std::string fingerprint = sources.fingerprint();
+        graph->buffer_manager = std::make_unique<BufferManager>(true);
+        graph->graph_manager = std::make_unique<GraphManager>(*graph->buffer_manager);
+        bulkLoadGraph(*graph->graph_manager, sources.users, sources.connections, sources.posts);
+        graph->buffer_manager->checkpoint();
+        graph->graph_manager->setMetadata(CSV_SOURCE_METADATA, fingerprint);
+        graph->buffer_manager->checkpoint();
+        return graph;
+    }
+};
+
+void test_createNode() {
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+
+    auto node1 = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
+    assert(node1 == 1);
+
+    auto node2 = graph_manager.createNode({{"name", PropertyValue("Node2")}, {"type", PropertyValue("user")}});
+    assert(node2 == 2);
+
+    SNode snode1 = graph_manager.getNode(node1);
+    assert(snode1.id == 1);
+    assert(snode1.convert().getProperty("name").value() == PropertyValue("Node1"));
+
+    SNode snode2 = graph_manager.getNode(node2);
+    assert(snode2.id == 2);
+    assert(snode2.convert().getProperty("name").value() == PropertyValue("Node2"));
+
+    std::cout << "\033[1m\033[32mPassed: test_createNode\033[0m" << std::endl;
+}
+
+void test_addNodeProperty() {
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+
+    auto node = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
+    assert(graph_manager.addNodeProperty(node, "age", PropertyValue(25)) == true);
+
+    Node converted_node = graph_manager.getNode(node).convert();
+
+    assert(converted_node.getProperty("age").has_value());
+    assert(converted_node.getProperty("age").value() == PropertyValue(25));
+
+    std::cout << "\033[1m\033[32mPassed: test_addNodeProperty\033[0m" << std::endl;
+}
+
+void test_createEdge() {
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+
+    auto node1 = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
+    auto node2 = graph_manager.createNode({{"name", PropertyValue("Node2")}, {"type", PropertyValue("user")}});
+
+    auto edge = graph_manager.createEdge(node1, node2, {{"weight", PropertyValue(10)}}, true);
+    assert(edge == 1);
+
+    SEdge sedge = graph_manager.getEdge(edge);
+    assert(sedge.source == node1);
+    assert(sedge.target == node2);
+
+    std::cout << "\033[1m\033[32mPassed: test_createEdge\033[0m" << std::endl;
+}
+
+void test_addEdgeProperty() {
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+
+    auto node1 = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
+    auto node2 = graph_manager.createNode({{"name", PropertyValue("Node2")}, {"type", PropertyValue("user")}});
+    auto edge = graph_manager.createEdge(node1, node2, {{"weight", PropertyValue(10)}}, true);
+
+    assert(graph_manager.addEdgeProperty(edge, "label", PropertyValue("friendship")) == true);
+
+    Edge converted_edge = graph_manager.getEdge(edge).convert();
+    assert(converted_edge.getProperty("label").has_value());
+    assert(converted_edge.getProperty("label").value() == PropertyValue("friendship"));
+
+    std::cout << "\033[1m\033[32mPassed: test_addEdgeProperty\033[0m" << std::endl;
+}
+
+void test_recordPacking() {
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+
+    // Many small node records share a page
+    const uint32_t num_nodes = 500;
+    std::set<PageID> pages;
+    for (uint32_t i = 1; i <= num_nodes; ++i) {
+        auto node = graph_manager.createNode({{"type", PropertyValue("user")}, {"user_id", PropertyValue(static_cast<int>(i))}});
+        pages.insert(graph_manager.getNodeLocation(node).page_id);
+    }
+    assert(pages.size() < num_nodes / 20);
+
+    // A record that outgrows its slot keeps its location while its page has room
+    RecordID before = graph_manager.getNodeLocation(1);
+    assert(graph_manager.addNodeProperty(1, "bio", PropertyValue(std::string(200, 'x'))));
+    RecordID after = graph_manager.getNodeLocation(1);
+    assert(before.page_id == after.page_id && before.slot_id == after.slot_id);
+
+    // and is relocated once it does not fit there any more; both stay readable
+    before = graph_manager.getNodeLocation(2);
+    assert(graph_manager.addNodeProperty(2, "bio", PropertyValue(std::string(3000, 'y'))));
+    after = graph_manager.getNodeLocation(2);
+    assert(before.page_id != after.page_id);
+
+    // A record no page can hold is rejected before anything changes
+    RecordID location = graph_manager.getNodeLocation(3);
+    bool rejected = false;
+    try {
+        graph_manager.addNodeProperty(3, "bio", PropertyValue(std::string(5000, 'z')));
+    } catch (const std::length_error&) {
+        rejected = true;
+    }
+    assert(rejected && buffer_manager.fix_page(location.page_id)->getRecord(location.slot_id) != nullptr);
+    assert(!graph_manager.getNode(3).convert().getProperty("bio").has_value());
+    assert(graph_manager.findNodes("bio", PropertyValue(std::string(5000, 'z'))).empty());
+
+    Node node = graph_manager.getNode(1).convert();
+    assert(node.getProperty("user_id").value() == PropertyValue(1));
+    assert(node.getProperty("bio").value().asString().size() == 200);
+    assert(graph_manager.getNode(2).convert().getProperty("bio").value().asString().size() == 3000);
+    assert(graph_manager.getNode(num_nodes).convert().getProperty("user_id").value() == PropertyValue(static_cast<int>(num_nodes)));
+
+    std::cout << "\033[1m\033[32mPassed: test_recordPacking\033[0m" << std::endl;
+}
+
+void test_reopenDatabase() {
+    uint32_t alice, bob, post, friendship;
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        alice = graph_manager.createNode({{"name", PropertyValue("Alice")}, {"type", PropertyValue("user")}});
+        bob = graph_manager.createNode({{"name", PropertyValue("Bob")}, {"type", PropertyValue("user")}, {"score", PropertyValue(1.5f)}});
+        post = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(42)}});
+        friendship = graph_manager.createEdge(alice, bob, {{"relationship", PropertyValue("friends")}}, false);
+        graph_manager.createEdge(bob, post, {{"label", PropertyValue("posted")}});
+        graph_manager.addNodeProperty(alice, "age", PropertyValue(25));
+    }
+
+    // Reopen the existing file instead of truncating it
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+
+    Node alice_node = graph_manager.getNode(alice).convert();
+    assert(alice_node.getProperty("name").value() == PropertyValue("Alice"));
+    assert(alice_node.getProperty("age").value() == PropertyValue(25));
+    assert(graph_manager.getNode(bob).convert().getProperty("score").value() == PropertyValue(1.5f));
+    assert(graph_manager.getNode(post).convert().getProperty("likes").value() == PropertyValue(42));
+
+    auto edge = graph_manager.viewEdge(friendship);
+    assert(!edge->isDirected());
+    assert(edge->source() == alice && edge->target() == bob);
+    auto key_id = graph_manager.getKeyCatalog().lookup("relationship");
+    assert(key_id.has_value() && edge->findProperty(*key_id).has_value());
+
+    // Adjacency was rebuilt from the edge records
+    auto first_degree = graph_manager.findNthDegreeConnections(alice, 1);
+    assert(first_degree.size() == 1 && first_degree[0] == bob);
+
+    // New records continue after the recovered IDs
+    assert(graph_manager.createNode({{"name", PropertyValue("Carol")}}) == post + 1);
+
+    std::cout << "\033[1m\033[32mPassed: test_reopenDatabase\033[0m" << std::endl;
+}
+
+void test_dictionaryEncoding() {
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+
+    std::string content = "A post body that is too long to be worth a dictionary entry";
+    auto user1 = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Alice")}});
+    auto user2 = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Bob")}});
+    auto post = graph_manager.createNode({{"type", PropertyValue("post")}, {"content", PropertyValue(content)}});
+
+    // Short values share one code, compared without touching the string
+    uint16_t type_key = graph_manager.getKeyCatalog().lookup("type").value();
+    uint32_t user_code = graph_manager.getStringDictionary().lookup("user").value();
+    assert(graph_manager.viewNode(user1)->stringCode(type_key) == user_code);
+    assert(graph_manager.viewNode(user2)->stringCode(type_key) == user_code);
+    assert(graph_manager.viewNode(post)->stringCode(type_key) != user_code);
+
+    // Long values stay inline in the record
+    uint16_t content_key = graph_manager.getKeyCatalog().lookup("content").value();
+    auto post_view = graph_manager.viewNode(post);
+    assert(!post_view->stringCode(content_key).has_value());
+    assert(!graph_manager.getStringDictionary().lookup(content).has_value());
+    assert(post_view->propertyValue(post_view->findProperty(content_key).value()) == PropertyValue(content));
+
+    // Decoding resolves dictionary codes back to strings
+    assert(graph_manager.getNode(user2).convert().getProperty("name").value() == PropertyValue("Bob"));
+
+    std::cout << "\033[1m\033[32mPassed: test_dictionaryEncoding\033[0m" << std::endl;
+}
+
+void test_typedPropertyAccess() {
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+
+    std::string bio = "Long enough to be stored inline in the node record";
+    auto node = graph_manager.createNode({
+        {"name", PropertyValue("Alice")},
+        {"age", PropertyValue(25)},
+        {"score", PropertyValue(4.5f)},
+        {"bio", PropertyValue(bio)}
+    });
+    const auto& keys = graph_manager.getKeyCatalog();
+    std::string_view name;
+    {
+        auto view = graph_manager.viewNode(node);
+
+        assert(view->getInt(keys.lookup("age").value()) == 25);
+        assert(view->getFloat(keys.lookup("score").value()) == 4.5f);
+        assert(view->getString(keys.lookup("bio").value()) == std::string_view(bio));
+
+        // Wrong type or missing property yields nullopt
+        assert(!view->getInt(keys.lookup("name").value()).has_value());
+        assert(!view->getString(keys.lookup("age").value()).has_value());
+
+        name = view->getString(keys.lookup("name").value()).value();
+    }
+
+    // Dictionary strings outlive the view and stay valid while the dictionary grows
+    for (int i = 0; i < 100; ++i) {
+        graph_manager.createNode({{"name", PropertyValue("User" + std::to_string(i))}});
+    }
+    assert(name == "Alice");
+
+    // Setting an existing property replaces it
+    graph_manager.addNodeProperty(node, "age", PropertyValue(26));
+    assert(graph_manager.viewNode(node)->getInt(keys.lookup("age").value()) == 26);
+    assert(graph_manager.getNode(node).property_count == 4);
+
+    std::cout << "\033[1m\033[32mPassed: test_typedPropertyAccess\033[0m" << std::endl;
+}
+
+void test_labelIndex() {
+    uint32_t user, post, unlabeled;
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        user = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Alice")}});
+        post = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(3)}});
+        unlabeled = graph_manager.createNode({{"name", PropertyValue("Ghost")}});
+
+        assert(graph_manager.getNodesWithLabel("user").test(user));
+        assert(!graph_manager.getNodesWithLabel("user").test(post));
+        assert(graph_manager.getNodesWithLabel("post").count() == 1);
+        assert(graph_manager.getNodesWithLabel("group").count() == 0);
+
+        // Changing the type moves the node between label bitmaps
+        graph_manager.addNodeProperty(unlabeled, "type", PropertyValue("user"));
+        assert(graph_manager.getNodesWithLabel("user").count() == 2);
+        graph_manager.addNodeProperty(unlabeled, "type", PropertyValue("post"));
+        assert(graph_manager.getNodesWithLabel("user").count() == 1);
+        assert(graph_manager.getNodesWithLabel("post").test(unlabeled));
+    }
+
+    // The index is rebuilt from node records on open
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+    assert(graph_manager.getNodesWithLabel("user").test(user));
+    assert(graph_manager.getNodesWithLabel("post").test(post));
+    assert(graph_manager.getNodesWithLabel("post").test(unlabeled));
+
+    std::cout << "\033[1m\033[32mPassed: test_labelIndex\033[0m" << std::endl;
+}
+
+void test_likeAggregates() {
+    uint32_t alice, bob, post1, post2;
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        alice = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Alice")}});
+        bob = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Bob")}});
+        post1 = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(10)}});
+        post2 = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(5)}});
+
+        graph_manager.createEdge(alice, bob, {{"relationship", PropertyValue("friends")}}, false);
+        graph_manager.createEdge(alice, post1, {{"label", PropertyValue("posted")}});
+        graph_manager.createEdge(alice, post2, {{"label", PropertyValue("posted")}});
+        graph_manager.createEdge(bob, post2, {{"label", PropertyValue("posted")}});
+        assert(graph_manager.getAuthoredLikes(alice) == 15);
+        assert(graph_manager.getAuthoredLikes(bob) == 5);
+
+        // Likes changes reach every author, re-adding an edge does not double count
+        graph_manager.addNodeProperty(post1, "likes", PropertyValue(20));
+        graph_manager.createEdge(alice, post1, {{"label", PropertyValue("posted")}});
+        assert(graph_manager.getAuthoredLikes(alice) == 25);
+
+        // A node that stops being a post no longer contributes
+        graph_manager.addNodeProperty(post2, "type", PropertyValue("draft"));
+        assert(graph_manager.getAuthoredLikes(alice) == 20);
+        assert(graph_manager.getAuthoredLikes(bob) == 0);
+
+        auto connections = graph_manager.findConnectionsAndLikes(bob);
+        assert(connections["friends"].size() == 1 && connections["friends"][0].second == 20);
+    }
 
+    // Aggregates are rebuilt on open
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+    assert(graph_manager.getAuthoredLikes(alice) == 20);
+    assert(graph_manager.getAuthoredLikes(bob) == 0);
 
-    uint32_t next_node_id = 1;
-    uint32_t next_edge_id = MAX_NODES + 1;
-    std::optional<uint32_t> adj_matrix[MAX_NODES][MAX_NODES] = {}; // Fixed-size adjacency matrix using bool
+    std::cout << "\033[1m\033[32mPassed: test_likeAggregates\033[0m" << std::endl;
+}
 
-public:
-    GraphManager(BufferManager& bm) : buffer_manager(bm) {
+void test_bfsEngine() {
+    // Random directed graph with a few hubs so AUTO mode switches direction
+    const uint32_t num_nodes = 3000;
+    AdjacencyIndex out_edges, in_edges;
+    out_edges.ensureNode(num_nodes);
+    in_edges.ensureNode(num_nodes);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> pick(1, num_nodes);
+    uint32_t edge_id = 1;
+    for (uint32_t i = 0; i < num_nodes * 4; ++i) {
+        uint32_t source = (i % 10 == 0) ? pick(rng) % 5 + 1 : pick(rng);
+        uint32_t target = pick(rng);
+        out_edges.addEdge(source, target, edge_id);
+        in_edges.addEdge(target, source, edge_id++);
     }
 
-    SNode* createNode(const std::unordered_map<std::string, PropertyValue>& properties) {
-        if (next_node_id > MAX_NODES) {
-            throw std::overflow_error("Maximum number of nodes exceeded");
-        }
-        uint32_t id = next_node_id++;
-        SlottedPage* page = &buffer_manager.fix_page(id);
-        SNode* node = new (page->page_data.get()) SNode(id);
-
-        for (const auto& [key, value] : properties) {
-            node->addProperty(key, value);
-        }
+    // Reference: plain queue-based BFS
+    std::vector<size_t> depth_of(num_nodes + 1, SIZE_MAX);
+    std::queue<uint32_t> q;
+    depth_of[1] = 0;
+    q.push(1);
+    while (!q.empty()) {
+        uint32_t node = q.front();
+        q.pop();
+        out_edges.forEachNeighbor(node, [&](uint32_t neighbor, uint32_t) {
+            if (depth_of[neighbor] == SIZE_MAX) {
+                depth_of[neighbor] = depth_of[node] + 1;
+                q.push(neighbor);
+            }
+        });
+    }
 
-        buffer_manager.flushPage(id);
-        return node;
+    for (BfsMode mode : {BfsMode::AUTO, BfsMode::TOP_DOWN, BfsMode::BOTTOM_UP}) {
+        BfsEngine bfs(out_edges, in_edges, num_nodes, mode);
+        size_t reached = 0;
+        bfs.run(1, 6, [&](size_t depth, const std::vector<uint32_t>& frontier) {
+            for (uint32_t node : frontier) {
+                assert(depth_of[node] == depth);
+            }
+            reached += frontier.size();
+            return true;
+        });
+        size_t expected = std::count_if(depth_of.begin(), depth_of.end(), [](size_t d) { return d >= 1 && d <= 6; });
+        assert(reached == expected);
     }
 
-    bool addNodeProperty(uint32_t node_id, const std::string& property_name, const PropertyValue& value) {
-        if (node_id >= MAX_NODES) {
-            std::cerr << "Node ID exceeds maximum allowed value.\n";
-            return false;
-        }
+    std::cout << "\033[1m\033[32mPassed: test_bfsEngine\033[0m" << std::endl;
+}
 
-        SlottedPage* page = &buffer_manager.fix_page(node_id);
-        SNode* node = reinterpret_cast<SNode*>(page->page_data.get());
+void test_parallelBfs() {
+    const uint32_t num_nodes = 20000;
+    AdjacencyIndex out_edges, in_edges;
+    out_edges.ensureNode(num_nodes);
+    in_edges.ensureNode(num_nodes);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> pick(1, num_nodes);
+    for (uint32_t edge_id = 1; edge_id <= num_nodes * 5; ++edge_id) {
+        uint32_t source = pick(rng), target = pick(rng);
+        out_edges.addEdge(source, target, edge_id);
+        in_edges.addEdge(target, source, edge_id);
+    }
 
-        node->addProperty(property_name, value);
-        buffer_manager.flushPage(node_id);
-        return true;
+    auto levels = [&](BfsMode mode, ThreadPool* pool) {
+        std::vector<std::vector<uint32_t>> result;
+        BfsEngine(out_edges, in_edges, num_nodes, mode, pool).run(1, 8, [&](size_t, const std::vector<uint32_t>& frontier) {
+            result.push_back(frontier);
+            return true;
+        });
+        return result;
+    };
+
+    // Every level matches the serial run exactly, in both directions
+    ThreadPool pool(4);
+    for (BfsMode mode : {BfsMode::AUTO, BfsMode::TOP_DOWN, BfsMode::BOTTOM_UP}) {
+        auto serial = levels(mode, nullptr);
+        assert(serial.size() > 3);
+        assert(levels(mode, &pool) == serial);
+        assert(serial == levels(BfsMode::TOP_DOWN, nullptr));
     }
 
-    SEdge* createEdge(uint32_t source, uint32_t target, const std::unordered_map<std::string, PropertyValue>& properties, bool is_directed = true) {
-        if (source > MAX_NODES || target > MAX_NODES) {
-            throw std::out_of_range("Source or target node ID exceeds maximum node limit");
-        }
+    std::cout << "\033[1m\033[32mPassed: test_parallelBfs\033[0m" << std::endl;
+}
 
-        uint32_t id = next_edge_id++;
-        SlottedPage* page = &buffer_manager.fix_page(id);
-        SEdge* sedge = new (page->page_data.get()) SEdge(id, source, target);
+void test_shortestPath() {
+    const uint32_t num_nodes = 5000;
+    AdjacencyIndex out_edges, in_edges;
+    out_edges.ensureNode(num_nodes);
+    in_edges.ensureNode(num_nodes);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<uint32_t> pick(1, num_nodes);
+    for (uint32_t edge_id = 1; edge_id <= num_nodes * 2; ++edge_id) {
+        uint32_t source = pick(rng), target = pick(rng);
+        out_edges.addEdge(source, target, edge_id);
+        in_edges.addEdge(target, source, edge_id);
+    }
 
-        for (const auto& [key, value] : properties) {
-            sedge->addProperty(key, value);
+    std::vector<size_t> depth_of(num_nodes + 1, SIZE_MAX);
+    depth_of[1] = 0;
+    BfsEngine bfs(out_edges, in_edges, num_nodes);
+    bfs.run(1, SIZE_MAX, [&](size_t depth, const std::vector<uint32_t>& frontier) {
+        for (uint32_t node : frontier) {
+            depth_of[node] = depth;
         }
-
-        Edge edge = sedge->convert();
-        adj_matrix[source - 1][target - 1] = sedge->id;
-        if (!is_directed) {
-            adj_matrix[target - 1][source - 1] = sedge->id;
+        return true;
+    });
+
+    // Path length matches the one-sided search and every hop is a real edge
+    for (uint32_t target = 1; target <= num_nodes; target += 37) {
+        auto path = bfs.shortestPath(1, target, 64);
+        if (depth_of[target] == SIZE_MAX) {
+            assert(!path.has_value());
+            continue;
+        }
+        assert(path.has_value() && path->length() == depth_of[target]);
+        assert(path->nodes.front() == 1 && path->nodes.back() == target);
+        for (size_t i = 0; i < path->length(); ++i) {
+            assert(out_edges.findEdge(path->nodes[i], path->nodes[i + 1]) == path->edges[i]);
+        }
+        if (depth_of[target] > 1) {
+            assert(!bfs.shortestPath(1, target, depth_of[target] - 1).has_value());
         }
-
-        buffer_manager.flushPage(id);
-        return sedge;
     }
 
-    bool addEdgeProperty(uint32_t edge_id, const std::string& property_name, const PropertyValue& value) {
-        SlottedPage* page = &buffer_manager.fix_page(edge_id);
-        SEdge* edge = reinterpret_cast<SEdge*>(page->page_data.get());
+    // Through GraphManager, following undirected friendships
+    BufferManager buffer_manager;
+    GraphManager graph_manager(buffer_manager);
+    auto a = graph_manager.createNode({{"type", PropertyValue("user")}});
+    auto b = graph_manager.createNode({{"type", PropertyValue("user")}});
+    auto c = graph_manager.createNode({{"type", PropertyValue("user")}});
+    auto ab = graph_manager.createEdge(a, b, {{"relationship", PropertyValue("friends")}}, false);
+    auto bc = graph_manager.createEdge(b, c, {{"relationship", PropertyValue("friends")}}, false);
+    auto path = graph_manager.shortestPath(c, a, 4);
+    assert(path.has_value());
+    assert((path->nodes == std::vector<uint32_t>{c, b, a}));
+    assert((path->edges == std::vector<uint32_t>{bc, ab}));
+    assert(graph_manager.shortestPath(a, a, 0)->length() == 0);
+
+    std::cout << "\033[1m\033[32mPassed: test_shortestPath\033[0m" << std::endl;
+}
 
-        edge->addProperty(property_name, value);
-        buffer_manager.flushPage(edge_id);
-        return true;
+void test_bufferPool() {
+    const size_t num_frames = 4;
+    const PageID num_pages = 16;
+    BufferManager buffer_manager(true, num_frames);
+
+    // Each page holds one counter record in slot 0
+    std::vector<PageID> pages;
+    for (PageID i = 0; i < num_pages; ++i) {
+        PageID page_id = buffer_manager.allocatePage();
+        PageGuard page = buffer_manager.fix_page(page_id, true);
+        int64_t counter = 0;
+        assert(page->addRecord(reinterpret_cast<const char*>(&counter), sizeof(counter)) == 0);
+        page.markDirty();
+        pages.push_back(page_id);
     }
 
-    std::vector<size_t> findNthDegreeConnections(size_t start_node, size_t degree) {
-        if (start_node < 1 || start_node > MAX_NODES) {
-            throw std::out_of_range("Start node is out of range");
+    // Pinned frames are never evicted; a full pool of pins is an error
+    {
+        std::vector<PageGuard> pinned;
+        for (size_t i = 0; i < num_frames; ++i) {
+            pinned.push_back(buffer_manager.fix_page(pages[i]));
         }
-
-        if (degree == 0) {
-            throw std::invalid_argument("Degree must be greater than 0");
+        bool exhausted = false;
+        try {
+            buffer_manager.fix_page(pages[num_frames]);
+        } catch (const std::runtime_error&) {
+            exhausted = true;
         }
+        assert(exhausted);
 
-        std::vector<bool> visited(MAX_NODES, false);
-        std::queue<std::pair<size_t, size_t>> q;
-        std::vector<size_t> nth_degree_connections;
-
-        q.push({start_node - 1, 0});
-        visited[start_node - 1] = true;
-
-        while (!q.empty()) {
-            auto [current_node, current_degree] = q.front();
-            q.pop();
+        // Shared guards on the same page coexist across threads
+        std::thread reader([&]() {
+            PageGuard again = buffer_manager.fix_page(pages[0]);
+            assert(again.pageId() == pages[0]);
+        });
+        reader.join();
 
-            if (current_degree == degree) {
-                SlottedPage* page = &buffer_manager.fix_page(current_node + 1);
-                SNode* snode = reinterpret_cast<SNode*>(page->page_data.get());
-                Node node = snode->convert();
-                if (node.getProperty("type").has_value() && node.getProperty("type").value() == PropertyValue("user")) { 
-                    nth_degree_connections.push_back(current_node + 1);
-                }
-                continue;
-            }
+        pinned.back().release();
+        PageGuard page = buffer_manager.fix_page(pages[num_frames]);
+        assert(page->getRecord(0) != nullptr);
+    }
 
-            for (size_t neighbor = 0; neighbor < MAX_NODES; ++neighbor) {
-                if (adj_matrix[current_node][neighbor] && !visited[neighbor]) {
-                    q.push({neighbor, current_degree + 1});
-                    visited[neighbor] = true;
-                }
+    // Concurrent writers increment counters across more pages than frames,
+    // so updates must survive eviction and reload
+    const int num_threads = 4;
+    const int increments = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            for (int i = 0; i < increments; ++i) {
+                PageGuard page = buffer_manager.fix_page(pages[rng() % num_pages], true);
+                int64_t counter;
+                std::memcpy(&counter, page->getRecord(0), sizeof(counter));
+                ++counter;
+                page->updateRecord(0, reinterpret_cast<const char*>(&counter), sizeof(counter));
+                page.markDirty();
             }
-        }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
 
-        return nth_degree_connections;
+    int64_t total = 0;
+    for (PageID page_id : pages) {
+        PageGuard page = buffer_manager.fix_page(page_id);
+        int64_t counter;
+        std::memcpy(&counter, page->getRecord(0), sizeof(counter));
+        total += counter;
     }
+    assert(total == num_threads * increments);
 
-    std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> findConnectionsAndLikes(uint32_t user_id) {
-        if (user_id < 1 || user_id > MAX_NODES) {
-            throw std::out_of_range("User ID is out of range");
-        }
+    std::cout << "\033[1m\033[32mPassed: test_bufferPool\033[0m" << std::endl;
+}
 
-        std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> result = {
-            {"colleagues", {}},
-            {"friends", {}}
-        };
+void test_replacementPolicies() {
+    const size_t num_frames = 8;
+    const PageID hot_pages = 2;
+    const PageID cold_pages = 7; // Hot reuse distance exceeds the pool, so LRU misses every time
+    const int rounds = 20;
+
+    std::map<ReplacementPolicy, BufferStats> results;
+    for (ReplacementPolicy kind : {ReplacementPolicy::LRU, ReplacementPolicy::CLOCK,
+                                   ReplacementPolicy::TWO_Q, ReplacementPolicy::LRU_K}) {
+        BufferManager buffer_manager(true, num_frames, kind);
+        for (PageID i = 0; i < hot_pages + cold_pages * rounds; ++i) {
+            buffer_manager.allocatePage();
+        }
 
-        // Traverse the adjacency matrix
-        for (size_t neighbor = 0; neighbor < MAX_NODES; ++neighbor) {
-            if (!adj_matrix[user_id - 1][neighbor].has_value()) {
-                continue; // Skip if there is no connection
+        // Every policy must skip pinned pages and report exhaustion
+        {
+            std::vector<PageGuard> pinned;
+            for (PageID page_id = 0; page_id < num_frames; ++page_id) {
+                pinned.push_back(buffer_manager.fix_page(page_id));
             }
+            bool exhausted = false;
+            try {
+                buffer_manager.fix_page(num_frames);
+            } catch (const std::runtime_error&) {
+                exhausted = true;
+            }
+            assert(exhausted);
+            pinned.erase(pinned.begin() + 3);
+            PageGuard page = buffer_manager.fix_page(num_frames);
+            for (const PageGuard& guard : pinned) {
+                assert(guard.pageId() != num_frames);
+            }
+        }
 
+        // A small hot set interleaved with a scan over pages touched once
+        buffer_manager.resetStats();
+        PageID next_cold = hot_pages;
+        for (int round = 0; round < rounds; ++round) {
+            for (PageID page_id = 0; page_id < hot_pages; ++page_id) {
+                buffer_manager.fix_page(page_id);
+            }
+            for (PageID i = 0; i < cold_pages; ++i) {
+                buffer_manager.fix_page(next_cold++);
+            }
+        }
 
-            // Retrieve neighbor node details
-            SlottedPage* neighbor_page = &buffer_manager.fix_page(neighbor + 1);
-            SNode* snode = reinterpret_cast<SNode*>(neighbor_page->page_data.get());
-            Node neighbor_node = snode->convert();
+        BufferStats stats = buffer_manager.getStats();
+        assert(stats.hits + stats.misses == rounds * (hot_pages + cold_pages));
+        results[kind] = stats;
+    }
 
-            auto type_property = neighbor_node.getProperty("type");
-            if (!type_property.has_value() || type_property.value().asString() != "user") {
-                continue;
-            }
+    // Scan-resistant policies keep the hot set resident
+    assert(results[ReplacementPolicy::TWO_Q].misses < results[ReplacementPolicy::LRU].misses);
+    assert(results[ReplacementPolicy::LRU_K].misses < results[ReplacementPolicy::LRU].misses);
 
-            auto name_property = neighbor_node.getProperty("name");
-            if (!name_property.has_value()) {
-                continue;
-            }
+    std::cout << "\033[1m\033[32mPassed: test_replacementPolicies\033[0m" << std::endl;
+}
 
-            // Retrieve the edge details
-            uint32_t edge_id = adj_matrix[user_id - 1][neighbor].value();
-            SlottedPage* edge_page = &buffer_manager.fix_page(edge_id);
-            SEdge* sedge = reinterpret_cast<SEdge*>(edge_page->page_data.get());
-            Edge edge = sedge->convert();
+void test_dirtyPageWriteBack() {
+    const size_t num_frames = 2;
+    const PageID num_pages = 6;
+    auto read_counter = [](const PageGuard& page) {
+        int64_t counter;
+        std::memcpy(&counter, page->getRecord(0), sizeof(counter));
+        return counter;
+    };
+
+    {
+        BufferManager buffer_manager(true, num_frames);
+        for (PageID i = 0; i < num_pages; ++i) {
+            buffer_manager.allocatePage();
+        }
 
-            auto relationship_property = edge.getProperty("relationship");
-            if (!relationship_property.has_value()) {
-                continue;
+        // Evicting clean pages writes nothing
+        buffer_manager.resetStats();
+        for (PageID page_id = 0; page_id < num_pages; ++page_id) {
+            buffer_manager.fix_page(page_id);
+        }
+        assert(buffer_manager.getStats().evictions > 0);
+        assert(buffer_manager.getStats().writes == 0);
+
+        // A dirty page is written once, by eviction or by the flusher, and survives reload
+        {
+            PageGuard page = buffer_manager.fix_page(0, true);
+            int64_t counter = 7;
+            page->addRecord(reinterpret_cast<const char*>(&counter), sizeof(counter));
+            page.markDirty();
+        }
+        assert(buffer_manager.getNumDirtyPages() <= 1);
+        for (PageID page_id = 1; page_id < num_pages; ++page_id) {
+            buffer_manager.fix_page(page_id);
+        }
+        buffer_manager.wakeFlusher(); // Let a flusher pass that took the page finish counting it
+        assert(buffer_manager.getStats().writes == 1);
+        assert(buffer_manager.getNumDirtyPages() == 0);
+        assert(read_counter(buffer_manager.fix_page(0)) == 7);
+
+        // Batch write-back covers every dirty page
+        for (PageID page_id = 0; page_id < num_frames; ++page_id) {
+            PageGuard page = buffer_manager.fix_page(page_id, true);
+            int64_t counter = 100 + page_id;
+            if (page->getRecord(0) == nullptr) {
+                page->addRecord(reinterpret_cast<const char*>(&counter), sizeof(counter));
+            } else {
+                page->updateRecord(0, reinterpret_cast<const char*>(&counter), sizeof(counter));
             }
+            page.markDirty();
+        }
+        buffer_manager.flushDirtyPages();
+        assert(buffer_manager.getNumDirtyPages() == 0);
+
+        // A flusher pass writes back what was dirtied before it
+        {
+            PageGuard page = buffer_manager.fix_page(1, true);
+            int64_t counter = 42;
+            page->updateRecord(0, reinterpret_cast<const char*>(&counter), sizeof(counter));
+            page.markDirty();
+        }
+        buffer_manager.wakeFlusher();
+        assert(buffer_manager.getNumDirtyPages() == 0);
+    }
 
-            std::string relationship = relationship_property.value().asString();
+    // Everything written back is visible after reopening the file
+    BufferManager buffer_manager(false, num_frames);
+    assert(read_counter(buffer_manager.fix_page(0)) == 100);
+    assert(read_counter(buffer_manager.fix_page(1)) == 42);
 
-            // Count likes on posts connected to this neighbor
-            uint32_t likes = 0;
-            for (size_t neighbor2 = 0; neighbor2 < MAX_NODES; ++neighbor2) {
-                if (!adj_matrix[neighbor][neighbor2].has_value()) {
-                    continue;
-                }
+    std::cout << "\033[1m\033[32mPassed: test_dirtyPageWriteBack\033[0m" << std::endl;
+}
 
-                // Check if the connected node is a post
-                SlottedPage* neighbor2_page = &buffer_manager.fix_page(neighbor2 + 1);
-                SNode* snode2 = reinterpret_cast<SNode*>(neighbor2_page->page_data.get());
-                Node post_node = snode2->convert();
+void test_directIoStorage() {
+    const size_t num_frames = 2;
+    const PageID num_pages = 8;
 
-                auto post_type_property = post_node.getProperty("type");
-                if (!post_type_property.has_value() || post_type_property.value().asString() != "post") {
-                    continue;
-                }
+    for (bool direct_io : {false, true}) {
+        {
+            BufferManager buffer_manager(true, num_frames, ReplacementPolicy::LRU, direct_io);
+            for (PageID i = 0; i < num_pages; ++i) {
+                PageID page_id = buffer_manager.allocatePage();
+                PageGuard page = buffer_manager.fix_page(page_id, true);
 
-                auto post_likes_property = post_node.getProperty("likes");
-                if (post_likes_property.has_value()) {
-                    likes += post_likes_property.value().asInt();
-                }
-            }
+                // Frame buffers satisfy O_DIRECT alignment
+                assert(reinterpret_cast<uintptr_t>(page->page_data.get()) % PAGE_SIZE == 0);
 
-            // Add to the result based on the relationship type
-            std::string name = name_property.value().asString();
-            if (relationship == "colleagues") {
-                result["colleagues"].push_back({name, likes});
-            } else if (relationship == "friends") {
-                result["friends"].push_back({name, likes});
+                uint32_t stamp = page_id * 31 + 7;
+                page->addRecord(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+                page.markDirty();
             }
         }
 
-        return result;
+        // Every page round-trips through eviction and reopening
+        BufferManager buffer_manager(false, num_frames, ReplacementPolicy::LRU, direct_io);
+        assert(buffer_manager.getNumPages() == num_pages + 1);
+        for (PageID page_id = 1; page_id <= num_pages; ++page_id) {
+            PageGuard page = buffer_manager.fix_page(page_id);
+            uint32_t stamp;
+            std::memcpy(&stamp, page->getRecord(0), sizeof(stamp));
+            assert(stamp == page_id * 31 + 7);
+        }
     }
 
-    void printNodes() const {
-        std::unordered_set<size_t> nodes; // Use a set to ensure unique nodes
-        std::cout << "Nodes in the graph:\n";
-
-        for (size_t i = 0; i < MAX_NODES; ++i) {
-            for (size_t j = 0; j < MAX_NODES; ++j) {
-                if (adj_matrix[i][j]) {
-                    nodes.insert(i + 1); // Add source node
-                    nodes.insert(j + 1); // Add target node
-                }
-            }
-        }
+    std::cout << "\033[1m\033[32mPassed: test_directIoStorage\033[0m" << std::endl;
+}
 
-        // Print all unique nodes with their details
-        for (size_t node_id : nodes) {
-            SlottedPage* page = &buffer_manager.fix_page(node_id);
-            SNode* node = reinterpret_cast<SNode*>(page->page_data.get());
-            node->print(); // Use the node's print function
+void test_asyncPageReads() {
+    const PageID num_pages = 8;
+    auto stamp_of = [](PageID page_id) { return page_id * 131 + 5; };
+    {
+        BufferManager buffer_manager(true, 2);
+        for (PageID i = 0; i < num_pages; ++i) {
+            PageID page_id = buffer_manager.allocatePage();
+            PageGuard page = buffer_manager.fix_page(page_id, true);
+            uint32_t stamp = stamp_of(page_id);
+            page->addRecord(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+            page.markDirty();
         }
     }
 
-    void printEdges() const {
-        std::cout << "Edges in the graph:\n";
-        std::unordered_set<std::pair<size_t, size_t>, pair_hash> processed_edges;
-
-        for (size_t i = 0; i < MAX_NODES; ++i) {
-            for (size_t j = 0; j < MAX_NODES; ++j) {
-                if (adj_matrix[i][j]) {
-                    // Ensure (i + 1, j + 1) is processed only once
-                    auto edge = (i < j) ? std::make_pair(i, j) : std::make_pair(j, i);
-                    if (processed_edges.find(edge) == processed_edges.end()) {
-                        std::cout << "Edge: " << (i + 1) << " -> " << (j + 1);
-                        if (adj_matrix[j][i]) {
-                            std::cout << " (Undirected)";
-                        }
-                        std::cout << "\n";
-                        processed_edges.insert(edge);
-                    }
-                }
+    // Each backend delivers every page, in any order
+    auto check_reader = [&](auto make_reader) {
+        std::vector<PageBuffer> buffers;
+        std::vector<bool> ok(num_pages + 1, false);
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t completed = 0;
+        {
+            StorageManager storage_manager(false);
+            auto reader = make_reader(storage_manager.fd, [&](uint64_t tag, bool success) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ok[tag] = success;
+                completed++;
+                done.notify_all();
+            });
+            if (!reader) {
+                return;
+            }
+            for (PageID page_id = 1; page_id <= num_pages; ++page_id) {
+                buffers.push_back(allocatePageBuffer());
+                reader->read(page_id, page_id, buffers.back().get());
             }
+            reader->submit();
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&]() { return completed == num_pages; });
         }
+        for (PageID page_id = 1; page_id <= num_pages; ++page_id) {
+            assert(ok[page_id]);
+            SlottedPage page;
+            std::memcpy(page.page_data.get(), buffers[page_id - 1].get(), PAGE_SIZE);
+            uint32_t stamp;
+            std::memcpy(&stamp, page.getRecord(0), sizeof(stamp));
+            assert(stamp == stamp_of(page_id));
+        }
+    };
+    check_reader([](int fd, AsyncPageReader::Completion on_complete) {
+        return std::make_unique<ThreadPoolPageReader>(fd, std::move(on_complete));
+    });
+#ifdef BUZZDB_HAVE_IO_URING
+    check_reader([](int fd, AsyncPageReader::Completion on_complete) {
+        return IoUringPageReader::create(fd, std::move(on_complete), 4); // Shallow ring exercises backpressure
+    });
+#endif
+
+    // Prefetched pages are hits when fixed, and prefetching is capped at half the pool
+    BufferManager buffer_manager(false, 8);
+    std::vector<PageID> wanted;
+    for (PageID page_id = 1; page_id <= num_pages; ++page_id) {
+        wanted.push_back(page_id);
     }
-};
+    assert(buffer_manager.prefetch(wanted) == 4);
+    assert(buffer_manager.prefetch(wanted) == 4);
+    assert(buffer_manager.prefetch(wanted) == 0);
+    for (PageID page_id = 1; page_id <= num_pages; ++page_id) {
+        PageGuard page = buffer_manager.fix_page(page_id);
+        uint32_t stamp;
+        std::memcpy(&stamp, page->getRecord(0), sizeof(stamp));
+        assert(stamp == stamp_of(page_id));
+    }
+    BufferStats stats = buffer_manager.getStats();
+    assert(stats.prefetches == num_pages && stats.misses == 0 && stats.hits == num_pages);
 
-std::unordered_map<std::string, uint32_t> populateGraph(GraphManager& graph_manager) {
-    std::unordered_map<uint32_t, uint32_t> user_id_to_node_id;
-    std::unordered_map<std::string, uint32_t> name_to_node_id;
+    std::cout << "\033[1m\033[32mPassed: test_asyncPageReads\033[0m" << std::endl;
+}
 
-    // Step 1: Read `users.csv` and create nodes
-    std::ifstream users_file("users.csv");
+void test_snapshotMode() {
+    uint32_t alice, bob, carol, post;
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        alice = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Alice")}});
+        bob = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Bob")}});
+        carol = graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue("Carol")}});
+        post = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(9)}});
+        graph_manager.createEdge(alice, bob, {{"relationship", PropertyValue("friends")}});
+        graph_manager.createEdge(bob, carol, {{"relationship", PropertyValue("colleagues")}});
+        graph_manager.createEdge(bob, post, {{"label", PropertyValue("posted")}});
+    }
 
-    std::string line;
-    getline(users_file, line); // Skip header
+    BufferManager buffer_manager(ReadOnlySnapshot{AccessAdvice::RANDOM});
+    assert(buffer_manager.isReadOnly());
+    assert(buffer_manager.getAccessAdvice() == AccessAdvice::RANDOM);
+    GraphManager graph_manager(buffer_manager);
 
-    while (getline(users_file, line)) {
-        std::istringstream iss(line);
-        std::string user_id, name, age, location;
+    // Pages are views straight into the mapping, laid out like the file
+    {
+        PageGuard first = buffer_manager.fix_page(1);
+        PageGuard second = buffer_manager.fix_page(2);
+        assert(second->page_data.get() - first->page_data.get() == static_cast<ptrdiff_t>(PAGE_SIZE));
+    }
 
-        getline(iss, user_id, ',');
-        getline(iss, name, ',');
-        getline(iss, age, ',');
-        getline(iss, location, ',');
+    // Queries see the same graph
+    assert(graph_manager.getNode(bob).convert().getProperty("name").value() == PropertyValue("Bob"));
+    auto second_degree = graph_manager.findNthDegreeConnections(alice, 2);
+    assert(second_degree.size() == 1 && second_degree[0] == carol);
+    auto connections = graph_manager.findConnectionsAndLikes(bob);
+    assert(connections["colleagues"].size() == 1 && connections["colleagues"][0].first == "Carol");
+    assert(graph_manager.getAuthoredLikes(bob) == 9);
 
-        SNode* snode = graph_manager.createNode({
-            {"type", PropertyValue("user")},
-            {"user_id", PropertyValue(std::stoi(user_id))},
-            {"name", PropertyValue(name)},
-            {"age", PropertyValue(std::stoi(age))},
-            {"location", PropertyValue(location)}
-        });
+    // Nothing can be written
+    bool rejected = false;
+    try {
+        buffer_manager.fix_page(1, true);
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+    rejected = false;
+    try {
+        buffer_manager.allocatePage();
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    assert(rejected);
 
-        user_id_to_node_id[std::stoi(user_id)] = snode->id;
-        name_to_node_id[name] = snode->id;
+    std::cout << "\033[1m\033[32mPassed: test_snapshotMode\033[0m" << std::endl;
+}
+
+void test_bulkLoad() {
+    // Generated data, with CRLF line endings, a blank line, no final newline and rows
+    // referencing an unknown user thrown in
+    const int num_users = 300, num_connections = 900, num_posts = 200;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick_user(1, num_users);
+    const char* relationships[] = {"friends", "colleagues", "family"};
+    std::vector<std::array<int, 3>> connections;
+    std::vector<std::array<int, 3>> posts; // user, post_id, likes
+    {
+        std::ofstream users_file("bulk_users.csv");
+        users_file << "user_id,name,age,location\r\n";
+        for (int user = 1; user <= num_users; ++user) {
+            users_file << user << ",User" << user << "," << 20 + user % 40 << ",City" << user % 17 << "\r\n";
+        }
+        std::ofstream connections_file("bulk_connections.csv");
+        connections_file << "source,target,relationship\n";
+        for (int i = 0; i < num_connections; ++i) {
+            connections.push_back({pick_user(rng), pick_user(rng), i % 3});
+            connections_file << connections[i][0] << "," << connections[i][1] << "," << relationships[i % 3] << "\n";
+            if (i == num_connections / 2) {
+                connections_file << "\n" << num_users + 1 << ",1,friends\n"; // Unknown user, skipped
+            }
+        }
+        std::ofstream posts_file("bulk_posts.csv");
+        posts_file << "user_id,post_id,content,likes";
+        for (int i = 0; i < num_posts; ++i) {
+            posts.push_back({i == num_posts / 2 ? num_users + 1 : pick_user(rng), 1000 + i, i * 3 % 250});
+            posts_file << "\n" << posts[i][0] << "," << posts[i][1] << ",Post number " << i << "," << posts[i][2];
+        }
     }
 
-    users_file.close();
+    // Reference graph built one record at a time
+    std::vector<SNode> expected_nodes;
+    std::vector<std::vector<size_t>> expected_neighbors;
+    std::vector<int64_t> expected_likes;
+    size_t expected_posts;
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        for (int user = 1; user <= num_users; ++user) {
+            graph_manager.createNode({
+                {"type", PropertyValue("user")},
+                {"user_id", PropertyValue(user)},
+                {"name", PropertyValue("User" + std::to_string(user))},
+                {"age", PropertyValue(20 + user % 40)},
+                {"location", PropertyValue("City" + std::to_string(user % 17))}
+            });
+        }
+        for (const auto& connection : connections) {
+            graph_manager.createEdge(connection[0], connection[1], {{"relationship", PropertyValue(relationships[connection[2]])}}, false);
+        }
+        for (int i = 0; i < num_posts; ++i) {
+            uint32_t post = graph_manager.createNode({
+                {"type", PropertyValue("post")},
+                {"post_id", PropertyValue(posts[i][1])},
+                {"content", PropertyValue("Post number " + std::to_string(i))},
+                {"likes", PropertyValue(posts[i][2])}
+            });
+            if (posts[i][0] <= num_users) {
+                graph_manager.createEdge(posts[i][0], post, {{"label", PropertyValue("posted")}});
+            }
+        }
+        for (uint32_t node = 1; node <= static_cast<uint32_t>(num_users + num_posts); ++node) {
+            expected_nodes.push_back(graph_manager.getNode(node));
+            expected_neighbors.push_back(graph_manager.findNthDegreeConnections(node, 1));
+            expected_likes.push_back(graph_manager.getAuthoredLikes(node));
+        }
+        expected_posts = graph_manager.getNodesWithLabel("post").count();
+    }
 
-    // Step 2: Read `connections.csv` and create edges
-    std::ifstream connections_file("connections.csv");
+    auto check = [&](GraphManager& graph_manager) {
+        for (uint32_t node = 1; node <= static_cast<uint32_t>(num_users + num_posts); ++node) {
+            const SNode& expected = expected_nodes[node - 1];
+            Node actual = graph_manager.getNode(node).convert();
+            for (size_t i = 0; i < expected.property_count; ++i) {
+                assert(actual.getProperty(expected.property_names[i]).value() == expected.property_values[i]);
+            }
+            assert(graph_manager.findNthDegreeConnections(node, 1) == expected_neighbors[node - 1]);
+            assert(graph_manager.getAuthoredLikes(node) == expected_likes[node - 1]);
+        }
+        assert(graph_manager.getNodesWithLabel("post").count() == expected_posts);
+    };
+
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        // Several chunks per file even for these small inputs
+        auto name_to_node_id = bulkLoadGraph(graph_manager, "bulk_users.csv", "bulk_connections.csv", "bulk_posts.csv", 4);
+        assert(name_to_node_id.size() == static_cast<size_t>(num_users));
+        assert(name_to_node_id.at("User1") == 1 && name_to_node_id.at("User300") == 300);
+        check(graph_manager);
+
+        // Node records were packed into pages in ID order
+        for (uint32_t node = 2; node <= static_cast<uint32_t>(num_users + num_posts); ++node) {
+            assert(graph_manager.getNodeLocation(node - 1).page_id <= graph_manager.getNodeLocation(node).page_id);
+        }
+    }
 
-    getline(connections_file, line); // Skip header
+    // The bulk-written records read back the same way
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+    check(graph_manager);
 
-    while (getline(connections_file, line)) {
-        std::istringstream iss(line);
-        std::string source, target, relationship;
+    std::remove("bulk_users.csv");
+    std::remove("bulk_connections.csv");
+    std::remove("bulk_posts.csv");
 
-        getline(iss, source, ',');
-        getline(iss, target, ',');
-        getline(iss, relationship, ',');
+    std::cout << "\033[1m\033[32mPassed: test_bulkLoad\033[0m" << std::endl;
+}
 
-        graph_manager.createEdge(user_id_to_node_id[std::stoi(source)], user_id_to_node_id[std::stoi(target)], {
-            {"relationship", PropertyValue(relationship)}, 
-        }, false);
+void test_persistentGraph() {
+    CsvSources sources{"persist_users.csv", "persist_connections.csv", "persist_posts.csv"};
+    {
+        std::ofstream users_file(sources.users);
+        users_file << "user_id,name,age,location\n1,Alice,25,New York\n2,Bob,30,Chicago\n3,Carol,35,Boston\n";
+        std::ofstream connections_file(sources.connections);
+        connections_file << "source,target,relationship\n1,2,friends\n2,3,colleagues\n";
+        std::ofstream posts_file(sources.posts);
+        posts_file << "user_id,post_id,content,likes\n2,101,Hello,40\n";
     }
 
-    connections_file.close();
+    // Nothing loaded from these files yet
+    {
+        BufferManager buffer_manager;
+    }
+    assert(LoadedGraph::reopen(sources) == nullptr);
 
-    // Step 3: Read `posts.csv` and create nodes and edges
-    std::ifstream posts_file("posts.csv");
+    {
+        auto graph = LoadedGraph::populate(sources);
+        assert(graph->findUser("Carol") == 3u);
+    }
 
-    getline(posts_file, line); // Skip header
+    // A second open reuses the stored graph, name index included
+    {
+        auto graph = LoadedGraph::reopen(sources);
+        assert(graph != nullptr);
+        assert(graph->findUser("Alice") == 1u && graph->findUser("Bob") == 2u);
+        assert(!graph->findUser("Dave").has_value());
+        auto connections = graph->graph_manager->findConnectionsAndLikes(graph->findUser("Carol").value());
+        assert(connections["colleagues"].size() == 1 && connections["colleagues"][0].second == 40);
+    }
 
-    while (getline(posts_file, line)) {
-        std::istringstream iss(line);
-        std::string user_id, post_id, content, likes;
+    // Changed CSVs make the stored graph stale
+    {
+        std::ofstream users_file(sources.users, std::ios::app);
+        users_file << "4,Dave,40,Denver\n";
+    }
+    assert(LoadedGraph::reopen(sources) == nullptr);
+    assert(LoadedGraph::populate(sources)->findUser("Dave") == 4u);
 
-        getline(iss, user_id, ',');
-        getline(iss, post_id, ',');
-        getline(iss, content, ',');
-        getline(iss, likes, ',');
+    std::remove(sources.users.c_str());
+    std::remove(sources.connections.c_str());
+    std::remove(sources.posts.c_str());
 
-        SNode* snode = graph_manager.createNode({
-            {"type", PropertyValue("post")},
-            {"post_id", PropertyValue(std::stoi(post_id))},
-            {"content", PropertyValue(content)},
-            {"likes", PropertyValue(std::stoi(likes))},
-        });
+    std::cout << "\033[1m\033[32mPassed: test_persistentGraph\033[0m" << std::endl;
+}
 
-        graph_manager.createEdge(user_id_to_node_id[std::stoi(user_id)], snode->id, {
-            {"label", PropertyValue("posted")},
-        });
+void test_propertyIndex() {
+    // Enough users to split leaves and inner nodes of the name index several times
+    const uint32_t num_users = 3000;
+    auto nameOf = [](uint32_t i) { return "user" + std::to_string(i % 1000) + "_" + std::to_string(i); };
+    std::string long_name(300, 'x');
+    uint32_t twin1, twin2, long1, long2;
+    {
+        // A bulk insert that creates the index puts each node in once
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        std::vector<SNode> nodes;
+        for (int i = 0; i < 3; ++i) {
+            nodes.emplace_back(0);
+            nodes.back().addProperty("name", PropertyValue("Bulk"));
+        }
+        uint32_t first = graph_manager.createNodes(std::move(nodes));
+        assert(graph_manager.findNodes("name", PropertyValue("Bulk")) == (std::vector<uint32_t>{first, first + 1, first + 2}));
+    }
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        for (uint32_t i = 1; i <= num_users; ++i) {
+            graph_manager.createNode({{"type", PropertyValue("user")}, {"name", PropertyValue(nameOf(i))},
+                                      {"user_id", PropertyValue(static_cast<int>(i) - 1000)}});
+        }
+        twin1 = graph_manager.createNode({{"name", PropertyValue("Twin")}});
+        twin2 = graph_manager.createNode({{"name", PropertyValue("Twin")}});
+        long1 = graph_manager.createNode({{"name", PropertyValue(long_name + "a")}});
+        long2 = graph_manager.createNode({{"name", PropertyValue(long_name + "b")}});
+
+        assert(graph_manager.findNodes("name", PropertyValue(nameOf(1234))) == std::vector<uint32_t>{1234});
+        assert(graph_manager.findNodes("name", PropertyValue(nameOf(1))) == std::vector<uint32_t>{1}); // Created the index
+        assert(graph_manager.findNodes("name", PropertyValue("Twin")) == (std::vector<uint32_t>{twin1, twin2}));
+        assert(graph_manager.findNodes("name", PropertyValue(long_name + "b")) == std::vector<uint32_t>{long2});
+        assert(graph_manager.findNodes("name", PropertyValue("nobody")).empty());
+
+        // Renaming moves the node within the index
+        graph_manager.addNodeProperty(7, "name", PropertyValue("Renamed"));
+        assert(graph_manager.findNodes("name", PropertyValue(nameOf(7))).empty());
+        assert(graph_manager.findNodes("name", PropertyValue("Renamed")) == std::vector<uint32_t>{7});
     }
 
-    posts_file.close();
-    return name_to_node_id;
+    // Everything is read back from the index pages
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+    assert(graph_manager.findNodes("name", PropertyValue("Renamed")) == std::vector<uint32_t>{7});
+    assert(graph_manager.findNodes("user_id", PropertyValue(0)) == std::vector<uint32_t>{1000});
+
+    // Prefix scans come back in name order: user12_1012, user12_12, user12_2012
+    assert(graph_manager.findNodesWithPrefix("name", "user12_") == (std::vector<uint32_t>{1012, 12, 2012}));
+    assert(graph_manager.findNodesWithPrefix("name", "user99").size() == 33);
+    assert(graph_manager.findNodesWithPrefix("name", long_name) == (std::vector<uint32_t>{long1, long2}));
+
+    // Exclusive bounds on names longer than the index keys hold
+    PropertyValue long_a(long_name + "a"), long_b(long_name + "b");
+    assert(graph_manager.findNodes({PropertyPredicate{"name", long_a, long_b, false, true}}) == std::vector<uint32_t>{long2});
+    assert(graph_manager.findNodes({PropertyPredicate{"name", long_a, long_b, true, false}}) == std::vector<uint32_t>{long1});
+    assert(graph_manager.findNodes({PropertyPredicate::greaterThan("name", long_a)}) == std::vector<uint32_t>{long2});
+
+    // Ranges include both ends and order negative before positive values
+    std::vector<uint32_t> range = graph_manager.findNodes({PropertyPredicate::between("user_id", PropertyValue(-10), PropertyValue(10))});
+    std::vector<uint32_t> expected(21);
+    std::iota(expected.begin(), expected.end(), 990);
+    assert(range == expected);
+    assert(graph_manager.findNodes({PropertyPredicate::between("user_id", PropertyValue(5000), PropertyValue(6000))}).empty());
+
+    // Properties without an index fall back to reading the nodes
+    assert(graph_manager.findNodes("type", PropertyValue("user")).size() == num_users);
+
+    std::cout << "\033[1m\033[32mPassed: test_propertyIndex\033[0m" << std::endl;
 }
 
-void test_createNode() {
-    BufferManager buffer_manager;
-    GraphManager graph_manager(buffer_manager);
+void test_secondaryIndexes() {
+    const char* cities[] = {"Chicago", "Boston", "Denver"};
+    std::mt19937 rng(11);
+    std::vector<int> ages = {0}, likes = {0}; // By node ID
+    std::vector<std::string> locations = {""};
+    auto expect = [](size_t count, auto&& pred) {
+        std::vector<uint32_t> ids;
+        for (uint32_t id = 1; id < count; ++id) {
+            if (pred(id)) {
+                ids.push_back(id);
+            }
+        }
+        return ids;
+    };
+    using P = PropertyPredicate;
+
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        auto addUser = [&]() {
+            ages.push_back(18 + rng() % 40);
+            locations.push_back(cities[rng() % 3]);
+            likes.push_back(static_cast<int>(rng() % 300) - 50);
+            graph_manager.createNode({{"type", PropertyValue("user")}, {"age", PropertyValue(ages.back())},
+                                      {"location", PropertyValue(locations.back())}, {"likes", PropertyValue(likes.back())}});
+        };
+        for (int i = 0; i < 1000; ++i) {
+            addUser();
+        }
+        // Built over the existing nodes, then maintained for new ones
+        graph_manager.createNodeIndex("age");
+        graph_manager.createNodeIndex("location");
+        for (int i = 0; i < 1000; ++i) {
+            addUser();
+        }
+        graph_manager.addNodeProperty(5, "age", PropertyValue(99));
+        ages[5] = 99;
+        graph_manager.createNode({{"likes", PropertyValue("lots")}}); // Not an int, never in a numeric range
+        ages.push_back(-1);
+        likes.push_back(-1000);
+        locations.push_back("");
+
+        auto a = graph_manager.createNode({{"name", PropertyValue("A")}});
+        auto b = graph_manager.createNode({{"name", PropertyValue("B")}});
+        graph_manager.createEdge(a, b, {{"relationship", PropertyValue("friends")}, {"since", PropertyValue(2015)}});
+        graph_manager.createEdgeIndex("since");
+        graph_manager.createEdge(b, a, {{"relationship", PropertyValue("colleagues")}, {"since", PropertyValue(2020)}});
+        assert(graph_manager.findEdges({P::atLeast("since", PropertyValue(2016))}) == std::vector<uint32_t>{2});
+        assert(graph_manager.findEdges({P::equals("relationship", PropertyValue("friends"))}) == std::vector<uint32_t>{1});
+    }
 
-    auto node1 = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
-    assert(node1->id == 1);
+    // Reopen: the indexes come back with the database
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+    assert(graph_manager.hasNodeIndex("age") && graph_manager.hasNodeIndex("location") && !graph_manager.hasNodeIndex("likes"));
+    assert(graph_manager.hasEdgeIndex("since"));
+    size_t count = ages.size();
+
+    // Indexed range and equality, intersected
+    auto found = graph_manager.findNodes({P::between("age", PropertyValue(25), PropertyValue(30)),
+                                          P::equals("location", PropertyValue("Chicago"))});
+    assert(!found.empty());
+    assert(found == expect(count, [&](uint32_t id) { return ages[id] >= 25 && ages[id] <= 30 && locations[id] == "Chicago"; }));
+    assert(graph_manager.findNodes({P::equals("age", PropertyValue(99))}) == std::vector<uint32_t>{5});
+
+    // Exclusive and open bounds
+    assert(graph_manager.findNodes({P::greaterThan("age", PropertyValue(30)), P::lessThan("age", PropertyValue(40))}) ==
+           expect(count, [&](uint32_t id) { return ages[id] > 30 && ages[id] < 40; }));
+    assert(graph_manager.findNodes({P::atMost("age", PropertyValue(20))}) ==
+           expect(count, [&](uint32_t id) { return ages[id] >= 0 && ages[id] <= 20; }));
+
+    // An unindexed property gives the same answers by reading the records
+    auto popular = graph_manager.findNodes({P::greaterThan("likes", PropertyValue(100))});
+    assert(popular == expect(count, [&](uint32_t id) { return likes[id] > 100; }));
+    graph_manager.createNodeIndex("likes");
+    assert(graph_manager.findNodes({P::greaterThan("likes", PropertyValue(100))}) == popular);
+    assert(graph_manager.findNodes({P::equals("likes", PropertyValue("lots"))}).size() == 1);
+
+    std::cout << "\033[1m\033[32mPassed: test_secondaryIndexes\033[0m" << std::endl;
+}
 
-    auto node2 = graph_manager.createNode({{"name", PropertyValue("Node2")}, {"type", PropertyValue("user")}});
-    assert(node2->id == 2);
+void test_writeAheadLog() {
+    constexpr uint32_t alice = 1, bob = 2, friendship = 1;
+    // A child process commits some changes and dies before any page reaches the file
+    pid_t child = ::fork();
+    assert(child >= 0);
+    if (child == 0) {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        graph_manager.createNode({{"name", PropertyValue("Alice")}, {"type", PropertyValue("user")}});
+        graph_manager.createNode({{"name", PropertyValue("Bob")}, {"type", PropertyValue("user")}});
+        graph_manager.createEdge(alice, bob, {{"relationship", PropertyValue("friends")}});
+        graph_manager.addNodeProperty(alice, "age", PropertyValue(25));
+        graph_manager.setMetadata("version", "1");
+        graph_manager.setMetadata("version", "2");
+        graph_manager.commit();
+        [[maybe_unused]] int result = ::truncate(database_filename.c_str(), 0);
+        ::raise(SIGKILL);
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+    // A torn record at the end of the log is ignored
+    {
+        std::ofstream wal_file(wal_filename, std::ios::binary | std::ios::app);
+        wal_file << "torn";
+    }
 
-    SlottedPage* page1 = &buffer_manager.fix_page(node1->id);
-    SNode* snode1 = reinterpret_cast<SNode*>(page1->page_data.get());
-    assert(snode1->id == 1);
+    {
+        BufferManager buffer_manager(false);
+        assert(buffer_manager.getNumRecoveredRecords() > 0);
+        GraphManager graph_manager(buffer_manager);
+        Node alice_node = graph_manager.getNode(alice).convert();
+        assert(alice_node.getProperty("name").value() == PropertyValue("Alice"));
+        assert(alice_node.getProperty("age").value() == PropertyValue(25));
+        assert(graph_manager.viewEdge(friendship)->target() == bob);
+        auto first_degree = graph_manager.findNthDegreeConnections(alice, 1);
+        assert(first_degree.size() == 1 && first_degree[0] == bob);
+        assert(graph_manager.findNodes("name", PropertyValue("Bob")) == std::vector<uint32_t>{bob});
+        assert(graph_manager.getMetadata("version") == "2");
+        graph_manager.createNode({{"name", PropertyValue("Carol")}});
+    }
 
-    SlottedPage* page2 = &buffer_manager.fix_page(node2->id);
-    SNode* snode2 = reinterpret_cast<SNode*>(page2->page_data.get());
-    assert(snode2->id == 2);
+    // Recovery checkpointed, and a clean shutdown leaves nothing to redo
+    BufferManager buffer_manager(false);
+    assert(buffer_manager.getNumRecoveredRecords() == 0);
+    GraphManager graph_manager(buffer_manager);
+    assert(graph_manager.findNodes("name", PropertyValue("Carol")) == std::vector<uint32_t>{3});
 
-    std::cout << "\033[1m\033[32mPassed: test_createNode\033[0m" << std::endl;
+    std::cout << "\033[1m\033[32mPassed: test_writeAheadLog\033[0m" << std::endl;
 }
 
-void test_addNodeProperty() {
-    BufferManager buffer_manager;
-    GraphManager graph_manager(buffer_manager);
+void test_groupCommit() {
+    constexpr size_t num_threads = 4;
+    constexpr uint32_t commits_per_thread = 25;
+    {
+        BufferManager buffer_manager(true, num_threads + 2);
+        std::vector<PageID> pages;
+        for (size_t i = 0; i < num_threads; ++i) {
+            pages.push_back(buffer_manager.allocatePage());
+        }
 
-    auto node = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
-    assert(graph_manager.addNodeProperty(node->id, "age", PropertyValue(25)) == true);
+        // Writers on separate pages, each committing after every update. They go in rounds:
+        // all of them update, then all of them commit, so the first commit of a round
+        // makes every update of the round durable and the others share its sync.
+        std::mutex round_mutex;
+        std::condition_variable round_cv;
+        size_t arrived = 0;
+        uint64_t round = 0;
+        auto await_all = [&]() {
+            std::unique_lock<std::mutex> lock(round_mutex);
+            uint64_t current = round;
+            if (++arrived == num_threads) {
+                arrived = 0;
+                round++;
+                round_cv.notify_all();
+            } else {
+                round_cv.wait(lock, [&]() { return round != current; });
+            }
+        };
+        std::vector<std::thread> writers;
+        for (size_t i = 0; i < num_threads; ++i) {
+            writers.emplace_back([&, page_id = pages[i]]() {
+                for (uint32_t counter = 1; counter <= commits_per_thread; ++counter) {
+                    {
+                        PageGuard page = buffer_manager.fix_page(page_id, true);
+                        if (!page.updateRecord(0, reinterpret_cast<const char*>(&counter), sizeof(counter))) {
+                            page.addRecord(reinterpret_cast<const char*>(&counter), sizeof(counter));
+                        }
+                    }
+                    await_all();
+                    buffer_manager.commit();
+                    await_all();
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        uint64_t syncs = buffer_manager.getNumLogSyncs();
+        // The writers need one sync per round; the flusher may add a few of its own
+        assert(syncs < num_threads * commits_per_thread);
+
+        // Nothing new to make durable
+        buffer_manager.commit();
+        assert(buffer_manager.getNumLogSyncs() == syncs);
+
+        // Every committed update reached the pages in log order
+        for (PageID page_id : pages) {
+            PageGuard page = buffer_manager.fix_page(page_id);
+            assert(*reinterpret_cast<const uint32_t*>(page->getRecord(0)) == commits_per_thread);
+            assert(page->getLsn() > 0);
+        }
+    }
 
-    SlottedPage* page = &buffer_manager.fix_page(node->id);
-    SNode* snode = reinterpret_cast<SNode*>(page->page_data.get());
-    Node converted_node = snode->convert();
+    BufferManager buffer_manager(false);
+    assert(buffer_manager.getNumRecoveredRecords() == 0);
 
-    assert(converted_node.getProperty("age").has_value());
-    assert(converted_node.getProperty("age").value() == PropertyValue(25));
+    std::cout << "\033[1m\033[32mPassed: test_groupCommit\033[0m" << std::endl;
+}
 
-    std::cout << "\033[1m\033[32mPassed: test_addNodeProperty\033[0m" << std::endl;
+void test_applyBatch() {
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        auto alice = graph_manager.createNode({{"name", PropertyValue("Alice")}, {"type", PropertyValue("user")}});
+        auto bob = graph_manager.createNode({{"name", PropertyValue("Bob")}, {"type", PropertyValue("user")}});
+        auto post = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(10)}});
+        auto posted = graph_manager.createEdge(alice, post, {{"label", PropertyValue("posted")}});
+
+        // New users each posting one new post, following each other in a chain
+        const uint32_t num_users = 200;
+        uint32_t first_user = graph_manager.getNextNodeId();
+        uint32_t first_post = first_user + num_users;
+        uint32_t first_edge = graph_manager.getNextEdgeId();
+        GraphBatch batch;
+        for (uint32_t i = 0; i < num_users; ++i) {
+            SNode user(0);
+            user.addProperty("name", PropertyValue("user" + std::to_string(i)));
+            user.addProperty("type", PropertyValue("user"));
+            user.addProperty("age", PropertyValue(0));
+            batch.nodes.push_back(user);
+        }
+        for (uint32_t i = 0; i < num_users; ++i) {
+            SNode new_post(0);
+            new_post.addProperty("type", PropertyValue("post"));
+            new_post.addProperty("likes", PropertyValue(static_cast<int>(i)));
+            batch.nodes.push_back(new_post);
+            batch.edges.emplace_back(0, first_user + i, first_post + i);
+            if (i > 0) {
+                batch.edges.emplace_back(0, first_user + i - 1, first_user + i);
+            }
+        }
+        batch.node_updates.push_back({post, "likes", PropertyValue(25)});
+        batch.node_updates.push_back({first_post + 7, "likes", PropertyValue(100)});
+        batch.node_updates.push_back({bob, "name", PropertyValue("Robert")});
+        batch.node_updates.push_back({alice, "bio", PropertyValue(std::string(300, 'a'))}); // Outgrows its slot
+        batch.node_updates.push_back({bob, "type", PropertyValue("post")});
+        batch.node_updates.push_back({bob, "likes", PropertyValue(5)});
+        batch.edge_updates.push_back({posted, "since", PropertyValue(2020)});
+        batch.edge_updates.push_back({first_edge, "since", PropertyValue(2021)});
+        graph_manager.applyBatch(std::move(batch));
+
+        assert(graph_manager.getNextNodeId() == first_post + num_users);
+        assert(graph_manager.getAuthoredLikes(alice) == 25);
+        assert(graph_manager.getAuthoredLikes(first_user + 7) == 100);
+        assert(graph_manager.getAuthoredLikes(first_user + 8) == 8);
+        assert(graph_manager.getNodesWithLabel(POST_LABEL).test(bob));
+        auto second_degree = graph_manager.findNthDegreeConnections(first_user, 2);
+        assert(second_degree.size() == 1 && second_degree[0] == first_user + 2);
+
+        // Nothing is applied if an ID is unknown
+        GraphBatch invalid;
+        invalid.nodes.push_back(SNode(0));
+        invalid.edges.emplace_back(0, alice, graph_manager.getNextNodeId() + 1);
+        bool rejected = false;
+        try {
+            graph_manager.applyBatch(std::move(invalid));
+        } catch (const std::out_of_range&) {
+            rejected = true;
+        }
+        assert(rejected && graph_manager.getNextNodeId() == first_post + num_users);
+
+        // or if an updated record would not fit in a page
+        GraphBatch oversized;
+        oversized.nodes.push_back(SNode(0));
+        oversized.node_updates.push_back({alice, "bio", PropertyValue(std::string(5000, 'z'))});
+        rejected = false;
+        try {
+            graph_manager.applyBatch(std::move(oversized));
+        } catch (const std::length_error&) {
+            rejected = true;
+        }
+        assert(rejected && graph_manager.getNextNodeId() == first_post + num_users);
+        assert(graph_manager.getNode(alice).convert().getProperty("bio").value() == PropertyValue(std::string(300, 'a')));
+
+        // or if it updates an edge that one of its own edges replaces
+        uint32_t next_edge = graph_manager.getNextEdgeId();
+        GraphBatch replacing;
+        replacing.edges.emplace_back(0, alice, post);
+        replacing.edge_updates.push_back({posted, "since", PropertyValue(2022)});
+        rejected = false;
+        try {
+            graph_manager.applyBatch(std::move(replacing));
+        } catch (const std::out_of_range&) {
+            rejected = true;
+        }
+        assert(rejected && graph_manager.getNextEdgeId() == next_edge);
+        auto since_key = graph_manager.getKeyCatalog().lookup("since");
+        assert(graph_manager.viewEdge(posted)->getInt(*since_key) == 2020);
+
+        // Records rewritten in place take one fix per page, on top of reading each record once
+        GraphBatch updates;
+        std::set<PageID> pages;
+        for (uint32_t i = 0; i < num_users; ++i) {
+            updates.node_updates.push_back({first_user + i, "age", PropertyValue(static_cast<int>(20 + i % 30))});
+            pages.insert(graph_manager.getNodeLocation(first_user + i).page_id);
+        }
+        buffer_manager.resetStats();
+        graph_manager.applyBatch(std::move(updates));
+        BufferStats stats = buffer_manager.getStats();
+        assert(stats.hits + stats.misses <= num_users + pages.size());
+    }
+
+    // Committed and rebuilt from the records on reopen
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+    assert(graph_manager.findNodes("name", PropertyValue("Robert")) == std::vector<uint32_t>{2});
+    assert(graph_manager.findNodes("name", PropertyValue("Bob")).empty());
+    Node alice = graph_manager.getNode(1).convert();
+    assert(alice.getProperty("bio").value() == PropertyValue(std::string(300, 'a')));
+    assert(alice.getProperty("name").value() == PropertyValue("Alice"));
+    assert(graph_manager.getAuthoredLikes(1) == 25);
+    auto since = graph_manager.getKeyCatalog().lookup("since");
+    assert(graph_manager.viewEdge(1)->getInt(*since) == 2020 && graph_manager.viewEdge(2)->getInt(*since) == 2021);
+    assert(graph_manager.getNode(4).convert().getProperty("age").value() == PropertyValue(20));
+
+    std::cout << "\033[1m\033[32mPassed: test_applyBatch\033[0m" << std::endl;
 }
 
-void test_createEdge() {
+void test_mvccSnapshot() {
+    // A copy keeps the adjacency it was taken from, whatever is written afterwards
+    AdjacencyIndex original;
+    for (uint32_t i = 2; i < 100; ++i) {
+        original.addEdge(1, i, i);
+    }
+    original.compact();
+    original.addEdge(2, 3, 200);
+    AdjacencyIndex copy(original);
+    original.addEdge(1, 2, 300); // Overwrites a compacted entry
+    original.addEdge(2, 4, 301); // Lands in a shared delta chunk
+    for (uint32_t i = 0; i < 2 * MIN_DELTA_COMPACTION; ++i) {
+        original.addEdge(3, 1000 + i, 1000 + i); // Forces a compaction
+    }
+    assert(copy.findEdge(1, 2) == 2u && original.findEdge(1, 2) == 300u);
+    assert(!copy.findEdge(2, 4) && original.findEdge(2, 4) == 301u);
+    assert(copy.numEdges() == 99 && copy.degree(3) == 0 && copy.numNodes() == 99);
+
     BufferManager buffer_manager;
     GraphManager graph_manager(buffer_manager);
+    auto alice = graph_manager.createNode({{"name", PropertyValue("Alice")}, {"type", PropertyValue("user")}});
+    auto bob = graph_manager.createNode({{"name", PropertyValue("Bob")}, {"type", PropertyValue("user")}});
+    auto carol = graph_manager.createNode({{"name", PropertyValue("Carol")}, {"type", PropertyValue("user")}});
+    auto post = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(10)}});
+    auto knows = graph_manager.createEdge(alice, bob, {{"relationship", PropertyValue("friends")}});
+    graph_manager.createEdge(bob, post, {{"label", PropertyValue("posted")}});
+
+    // Mutations after the snapshot is taken stay invisible to it
+    {
+        GraphSnapshot snapshot = graph_manager.snapshot();
+        graph_manager.createEdge(alice, carol, {{"relationship", PropertyValue("colleagues")}});
+        graph_manager.addNodeProperty(bob, "name", PropertyValue("Robert"));
+        graph_manager.addNodeProperty(bob, "name", PropertyValue("Rob"));
+        graph_manager.addNodeProperty(post, "likes", PropertyValue(50));
+        graph_manager.addEdgeProperty(knows, "relationship", PropertyValue("colleagues"));
+        auto dave = graph_manager.createNode({{"name", PropertyValue("Dave")}, {"type", PropertyValue("user")}});
+        graph_manager.createEdge(carol, dave, {});
+        assert(graph_manager.getNumRecordVersions() == 4); // Bob twice, the post and the edge
+
+        auto before = snapshot.findConnectionsAndLikes(alice);
+        assert(before["friends"].size() == 1 && before["friends"][0] == std::make_pair(std::string("Bob"), 10));
+        assert(before["colleagues"].empty());
+        assert(snapshot.getNodeProperty(bob, "name") == PropertyValue("Bob"));
+        assert(snapshot.findNthDegreeConnections(alice, 2).empty());
+        assert(!snapshot.isNode(dave) && !snapshot.getNodesWithLabel("user").test(dave));
+
+        auto after = graph_manager.findConnectionsAndLikes(alice);
+        assert(after["colleagues"].size() == 2 && after["friends"].empty());
+        assert(graph_manager.getAuthoredLikes(bob) == 50);
+        assert(graph_manager.findNthDegreeConnections(alice, 2) == std::vector<size_t>{dave});
+    }
 
-    auto node1 = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
-    auto node2 = graph_manager.createNode({{"name", PropertyValue("Node2")}, {"type", PropertyValue("user")}});
+    // Versions nobody can read any more are dropped by the next mutation
+    graph_manager.addNodeProperty(carol, "age", PropertyValue(30));
+    assert(graph_manager.getNumRecordVersions() == 0);
 
-    auto edge = graph_manager.createEdge(node1->id, node2->id, {{"weight", PropertyValue(10)}}, true);
-    assert(edge->id == MAX_NODES + 1);
+    // A snapshot keeps the traversal pool it was taken with
+    graph_manager.setTraversalThreads(2);
+    {
+        GraphSnapshot snapshot = graph_manager.snapshot();
+        graph_manager.setTraversalThreads(1);
+        assert(snapshot.findNthDegreeConnections(alice, 1).size() == 2);
+    }
 
-    SlottedPage* page = &buffer_manager.fix_page(edge->id);
-    SEdge* sedge = reinterpret_cast<SEdge*>(page->page_data.get());
-    assert(sedge->source == node1->id);
-    assert(sedge->target == node2->id);
+    // Readers on their own snapshots always see both counters of a batch at the same value
+    std::atomic<bool> done{false};
+    std::thread reader([&] {
+        size_t reads = 0;
+        while (!done || reads == 0) {
+            GraphSnapshot snapshot = graph_manager.snapshot();
+            auto first = snapshot.getNodeProperty(alice, "counter");
+            auto second = snapshot.getNodeProperty(carol, "counter");
+            assert(first == second);
+            reads++;
+        }
+    });
+    for (int i = 0; i < 200; ++i) {
+        GraphBatch batch;
+        batch.node_updates.push_back({alice, "counter", PropertyValue(i)});
+        batch.node_updates.push_back({carol, "counter", PropertyValue(i)});
+        graph_manager.applyBatch(std::move(batch));
+    }
+    done = true;
+    reader.join();
+
+    // A writer waiting for the state latch keeps new readers out, then gets it once the
+    // readers it found are done
+    WriterPreferringLatch latch;
+    latch.lock_shared();
+    std::thread waiting_writer([&] {
+        latch.lock();
+        latch.unlock();
+    });
+    while (latch.try_lock_shared()) {
+        latch.unlock_shared();
+        std::this_thread::yield();
+    }
+    latch.unlock_shared();
+    waiting_writer.join();
+    assert(latch.try_lock_shared());
+    latch.unlock_shared();
 
-    std::cout << "\033[1m\033[32mPassed: test_createEdge\033[0m" << std::endl;
+    std::cout << "\033[1m\033[32mPassed: test_mvccSnapshot\033[0m" << std::endl;
 }
 
-void test_addEdgeProperty() {
-    BufferManager buffer_manager;
+void test_removeNodesAndEdges() {
+    // Removed compacted entries are skipped until compaction drops them; delta entries go at once
+    AdjacencyIndex adjacency;
+    for (uint32_t i = 2; i <= 10; ++i) {
+        adjacency.addEdge(1, i, i);
+    }
+    adjacency.compact();
+    adjacency.addEdge(1, 11, 11);
+    assert(adjacency.removeEdge(1, 3) && adjacency.removeEdge(1, 11));
+    assert(!adjacency.removeEdge(1, 3) && !adjacency.removeEdge(2, 1));
+    assert(!adjacency.findEdge(1, 3) && !adjacency.findEdge(1, 11));
+    assert(adjacency.degree(1) == 8 && adjacency.numEdges() == 8);
+    size_t visited = 0;
+    adjacency.forEachNeighbor(1, [&](uint32_t neighbor, uint32_t) {
+        assert(neighbor != 3);
+        visited++;
+    });
+    assert(visited == 8);
+    assert(adjacency.addEdge(1, 3, 30) && adjacency.findEdge(1, 3) == 30u); // Reuses the removed entry
+    adjacency.removeEdge(1, 4);
+    adjacency.compact();
+    assert(adjacency.degree(1) == 8 && adjacency.numEdges() == 8 && !adjacency.findEdge(1, 4));
+
+    {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        auto alice = graph_manager.createNode({{"name", PropertyValue("Alice")}, {"type", PropertyValue("user")}});
+        auto bob = graph_manager.createNode({{"name", PropertyValue("Bob")}, {"type", PropertyValue("user")}});
+        auto carol = graph_manager.createNode({{"name", PropertyValue("Carol")}, {"type", PropertyValue("user")}});
+        auto post = graph_manager.createNode({{"type", PropertyValue("post")}, {"likes", PropertyValue(10)}});
+        auto dave = graph_manager.createNode({{"name", PropertyValue("Dave")}, {"type", PropertyValue("user")}});
+        auto friends = graph_manager.createEdge(alice, bob, {{"relationship", PropertyValue("friends")}});
+        auto posted = graph_manager.createEdge(bob, post, {{"label", PropertyValue("posted")}});
+        graph_manager.createEdge(alice, carol, {{"relationship", PropertyValue("colleagues")}}, false);
+        graph_manager.createEdge(alice, post, {{"label", PropertyValue("posted")}});
+        graph_manager.createEdge(alice, dave, {{"tag", PropertyValue("old")}});
+        graph_manager.createEdge(alice, dave, {{"tag", PropertyValue("new")}}); // Replaces the previous edge
+        assert(graph_manager.findEdges({PropertyPredicate::equals("tag", PropertyValue("old"))}).empty());
+        graph_manager.createEdge(carol, alice, {{"tag", PropertyValue("mentor")}}); // Undirected edge keeps alice -> carol
+
+        // A batch replaces existing edges and its own earlier duplicates
+        SEdge first(0, carol, alice), second(0, carol, alice);
+        first.addProperty("tag", PropertyValue("first"));
+        second.addProperty("tag", PropertyValue("second"));
+        uint32_t first_id = graph_manager.createEdges({first, second});
+        assert(graph_manager.findEdges({PropertyPredicate::equals("tag", PropertyValue("first"))}).empty());
+        assert(graph_manager.findEdges({PropertyPredicate::equals("tag", PropertyValue("second"))}) == std::vector<uint32_t>{first_id + 1});
+        assert(graph_manager.findEdges({PropertyPredicate::equals("tag", PropertyValue("mentor"))}).empty());
+        assert(graph_manager.getAuthoredLikes(alice) == 10 && graph_manager.getAuthoredLikes(bob) == 10);
+
+        assert(graph_manager.removeEdge(friends) && !graph_manager.removeEdge(friends));
+        auto connections = graph_manager.findConnectionsAndLikes(alice);
+        assert(connections["friends"].empty() && connections["colleagues"].size() == 1);
+        assert(graph_manager.findEdges({PropertyPredicate::equals("relationship", PropertyValue("friends"))}).empty());
+
+        // Removing a node takes its edges along; open snapshots still see all of them
+        RecordID bob_location = graph_manager.getNodeLocation(bob);
+        {
+            GraphSnapshot snapshot = graph_manager.snapshot();
+            assert(graph_manager.removeNode(bob) && !graph_manager.removeNode(bob));
+            assert(graph_manager.findNodes("name", PropertyValue("Bob")).empty());
+            assert(!graph_manager.getNodesWithLabel("user").test(bob));
+            assert(graph_manager.findNthDegreeConnections(carol, 1) == std::vector<size_t>{alice});
+            assert(snapshot.isNode(bob) && snapshot.isEdge(posted) && !snapshot.isEdge(friends));
+            assert(snapshot.getNodeProperty(bob, "name") == PropertyValue("Bob"));
+            assert(snapshot.getNodesWithLabel("user").test(bob) && snapshot.getAuthoredLikes(bob) == 10);
+        }
+        assert(buffer_manager.fix_page(bob_location.page_id)->getRecord(bob_location.slot_id) == nullptr);
+
+        assert(graph_manager.removeNode(post) && graph_manager.getAuthoredLikes(alice) == 0);
+        assert(graph_manager.removeNode(dave));
+        assert(graph_manager.findEdges({PropertyPredicate::equals("tag", PropertyValue("new"))}).empty());
+    }
+
+    // Removals persist and IDs are not reused
+    BufferManager buffer_manager(false);
     GraphManager graph_manager(buffer_manager);
+    assert(graph_manager.findNodes({}) == (std::vector<uint32_t>{1, 3}));
+    assert(graph_manager.findEdges({PropertyPredicate::equals("tag", PropertyValue("old"))}).empty());
+    assert(graph_manager.findEdges({PropertyPredicate::equals("relationship", PropertyValue("colleagues"))}).size() == 1);
+    assert(graph_manager.findEdges({PropertyPredicate::equals("tag", PropertyValue("second"))}).size() == 1);
+    assert(graph_manager.findNthDegreeConnections(3, 1) == std::vector<size_t>{1});
+    assert(graph_manager.createNode({{"name", PropertyValue("Erin")}}) == 6);
+
+    std::cout << "\033[1m\033[32mPassed: test_removeNodesAndEdges\033[0m" << std::endl;
+}
 
-    auto node1 = graph_manager.createNode({{"name", PropertyValue("Node1")}, {"type", PropertyValue("user")}});
-    auto node2 = graph_manager.createNode({{"name", PropertyValue("Node2")}, {"type", PropertyValue("user")}});
-    auto edge = graph_manager.createEdge(node1->id, node2->id, {{"weight", PropertyValue(10)}}, true);
+void test_freeSpaceReuse() {
+    // Records of any length; deleted space is reclaimed by compaction and slots are reused
+    SlottedPage page;
+    std::vector<std::string> records = {std::string(40, 'a'), std::string(900, 'b'), std::string(700, 'c'), std::string(1200, 'd')};
+    for (size_t i = 0; i < records.size(); ++i) {
+        assert(page.addRecord(records[i].data(), records[i].size()) == i);
+    }
+    page.deleteTuple(1);
+    records[1] = std::string(1000, 'e');
+    assert(!page.addRecord(records[1].data(), records[1].size()).has_value());
+    assert(page.freeSpace() >= records[1].size());
+    assert(page.compact() == (std::vector<uint16_t>{2, 3}));
+    assert(page.addRecord(records[1].data(), records[1].size()) == 1);
+    records[0] = std::string(300, 'f');
+    assert(page.updateRecord(0, records[0].data(), records[0].size())); // Grows in place of the free space
+    size_t unused = page.unusedSpace();
+    records[0] = std::string(100, 'h');
+    assert(page.updateRecord(0, records[0].data(), records[0].size())); // Shrinks in place
+    assert(page.unusedSpace() == unused + 200 && page.getSlot(0).length == 100);
+    for (uint16_t slot = 0; slot < records.size(); ++slot) {
+        assert(std::string(page.getRecord(slot), records[slot].size()) == records[slot]);
+    }
+    auto tuple = std::make_unique<Tuple>();
+    tuple->addField(std::make_unique<Field>(std::string(100, 'g'))); // Tuples are not limited to 38 bytes either
+    assert(page.addTuple(std::move(tuple)));
+
+    // Lookups go to the fullest page with enough room
+    FreeSpaceMap free_space;
+    free_space.update(3, 1000);
+    free_space.update(5, 200);
+    assert(free_space.find(100) == 5 && free_space.find(500) == 3);
+    assert(free_space.find(2000) == INVALID_PAGE_ID);
+    free_space.update(5, 10);
+    assert(free_space.find(100) == 3);
+
+    // Space freed by removals is refilled before the file grows, and the compactions
+    // that took are redone after a crash
+    const uint32_t num_nodes = 200;
+    auto bio = [](uint32_t node_id) { return std::string(150, static_cast<char>('a' + node_id % 26)); };
+    pid_t child = ::fork();
+    assert(child >= 0);
+    if (child == 0) {
+        BufferManager buffer_manager;
+        GraphManager graph_manager(buffer_manager);
+        for (uint32_t i = 1; i <= num_nodes; ++i) {
+            graph_manager.createNode({{"bio", PropertyValue(bio(i))}});
+        }
+        for (uint32_t i = 1; i <= num_nodes; i += 2) {
+            graph_manager.removeNode(i);
+        }
+        size_t num_pages = buffer_manager.getNumPages();
+        for (uint32_t i = num_nodes + 1; i <= num_nodes + num_nodes / 2; ++i) {
+            graph_manager.createNode({{"bio", PropertyValue(bio(i))}});
+        }
+        graph_manager.commit();
+        if (buffer_manager.getNumPages() != num_pages) {
+            ::_exit(1);
+        }
+        [[maybe_unused]] int result = ::truncate(database_filename.c_str(), 0);
+        ::raise(SIGKILL);
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+    BufferManager buffer_manager(false);
+    GraphManager graph_manager(buffer_manager);
+    auto bio_key = graph_manager.getKeyCatalog().lookup("bio");
+    for (uint32_t i = 2; i <= num_nodes; i += 2) {
+        assert(graph_manager.viewNode(i)->getString(*bio_key) == bio(i));
+    }
+    for (uint32_t i = num_nodes + 1; i <= num_nodes + num_nodes / 2; ++i) {
+        assert(graph_manager.viewNode(i)->getString(*bio_key) == bio(i));
+    }
+    assert(graph_manager.findNodes({}).size() == num_nodes);
 
-    assert(graph_manager.addEdgeProperty(edge->id, "label", PropertyValue("friendship")) == true);
+    std::cout << "\033[1m\033[32mPassed: test_freeSpaceReuse\033[0m" << std::endl;
+}
 
-    SlottedPage* page = &buffer_manager.fix_page(edge->id);
-    SEdge* sedge = reinterpret_cast<SEdge*>(page->page_data.get());
-    Edge converted_edge = sedge->convert();
-    assert(converted_edge.getProperty("label").has_value());
-    assert(converted_edge.getProperty("label").value() == PropertyValue("friendship"));
+void test_adjacencyIndex() {
+    AdjacencyIndex adjacency;
 
-    std::cout << "\033[1m\033[32mPassed: test_addEdgeProperty\033[0m" << std::endl;
+    // Enough edges to force at least one compaction of the delta buffer
+    const uint32_t num_nodes = 200;
+    uint32_t edge_id = 1;
+    for (uint32_t source = 1; source <= num_nodes; ++source) {
+        for (uint32_t target = num_nodes; target >= 1; target -= 7) {
+            adjacency.addEdge(source, target, edge_id++);
+            if (target <= 7) {
+                break;
+            }
+        }
+    }
+    size_t num_edges = adjacency.numEdges();
+    assert(adjacency.numNodes() == num_nodes);
+
+    // Rows are visited in ascending neighbor order across CSR and delta entries
+    adjacency.addEdge(1, 3, 9999);
+    uint32_t previous = 0;
+    size_t visited = 0;
+    adjacency.forEachNeighbor(1, [&](uint32_t neighbor, uint32_t) {
+        assert(neighbor > previous);
+        previous = neighbor;
+        visited++;
+    });
+    assert(visited == adjacency.degree(1));
+    assert(adjacency.findEdge(1, 3).value() == 9999);
+
+    // Re-adding an existing edge overwrites its edge ID
+    adjacency.addEdge(1, num_nodes, 4242);
+    assert(adjacency.findEdge(1, num_nodes).value() == 4242);
+    assert(adjacency.numEdges() == num_edges + 1);
+
+    adjacency.compact();
+    assert(adjacency.numEdges() == num_edges + 1);
+    assert(adjacency.findEdge(1, 3).value() == 9999);
+    assert(!adjacency.findEdge(3, 1).has_value());
+
+    std::cout << "\033[1m\033[32mPassed: test_adjacencyIndex\033[0m" << std::endl;
 }
 
 int main() {
     try {
+        // Built or reopened on the first query, then shared by the following ones
+        std::unique_ptr<LoadedGraph> graph;
+        auto openGraph = [&graph]() -> LoadedGraph& {
+            if (graph == nullptr) {
+                graph = LoadedGraph::reopen();
+                if (graph != nullptr) {
+                    std::cout << PROMPT_COLOR << "Opening graph database...\n" << RESET;
+                } else {
+                    std::cout << PROMPT_COLOR << "Populating graph database...\n" << RESET;
+                    graph = LoadedGraph::populate();
+                }
+                graph->graph_manager->setTraversalThreads(std::thread::hardware_concurrency());
+            }
+            return *graph;
+        };
+
         while (true) {
             std::cout << PROMPT_COLOR << "Choose an option:\n";
             std::cout << "1. Run all unit tests\n";
@@ -1231,17 +8114,42 @@ int main() {
             switch (choice) {
                 case 1: {
                     std::cout << RESULT_COLOR << "Running unit tests...\n" << RESET;
+                    graph.reset(); // The tests overwrite the database file
                     test_createNode();
                     test_addNodeProperty();
                     test_createEdge();
                     test_addEdgeProperty();
+                    test_adjacencyIndex();
+                    test_recordPacking();
+                    test_reopenDatabase();
+                    test_dictionaryEncoding();
+                    test_typedPropertyAccess();
+                    test_labelIndex();
+                    test_likeAggregates();
+                    test_bfsEngine();
+                    test_parallelBfs();
+                    test_shortestPath();
+                    test_bufferPool();
+                    test_replacementPolicies();
+                    test_dirtyPageWriteBack();
+                    test_directIoStorage();
+                    test_asyncPageReads();
+                    test_snapshotMode();
+                    test_bulkLoad();
+                    test_persistentGraph();
+                    test_propertyIndex();
+                    test_secondaryIndexes();
+                    test_writeAheadLog();
+                    test_groupCommit();
+                    test_applyBatch();
+                    test_mvccSnapshot();
+                    test_removeNodesAndEdges();
+                    test_freeSpaceReuse();
                     break;
                 }
                 case 2: {
-                    BufferManager buffer_manager;
-                    GraphManager graph_manager(buffer_manager);
-                    std::cout << PROMPT_COLOR << "Populating graph database...\n" << RESET;
-                    auto name_to_node_id = populateGraph(graph_manager);
+                    LoadedGraph& loaded = openGraph();
+                    GraphManager& graph_manager = *loaded.graph_manager;
 
                     std::string name;
                     size_t degree;
@@ -1251,13 +8159,14 @@ int main() {
                     std::cout << PROMPT_COLOR << "Enter the degree of connections to find: " << RESET;
                     std::cin >> degree;
 
-                    if (name_to_node_id.find(name) == name_to_node_id.end()) {
+                    auto node_id = loaded.findUser(name);
+                    if (!node_id.has_value()) {
                         std::cerr << RESULT_COLOR << "Error: Name not found in the database.\n" << RESET;
                         break;
                     }
 
                     auto start_time = std::chrono::high_resolution_clock::now();
-                    std::vector<size_t> nth_degree_connections = graph_manager.findNthDegreeConnections(name_to_node_id[name], degree);
+                    std::vector<size_t> nth_degree_connections = graph_manager.findNthDegreeConnections(*node_id, degree);
                     auto end_time = std::chrono::high_resolution_clock::now();
 
                     std::chrono::duration<double> duration = end_time - start_time;
@@ -1266,33 +8175,30 @@ int main() {
 
                     std::cout << RESULT_COLOR << "Nodes connected to " << name << " within " << degree << " degrees:\n" << RESET;
                     for (size_t node_id : nth_degree_connections) {
-                        SlottedPage* page = &buffer_manager.fix_page(node_id);
-                        SNode* node = reinterpret_cast<SNode*>(page->page_data.get());
                         std::cout << RESULT_COLOR;
-                        node->print();
+                        graph_manager.getNode(node_id).print();
                         std::cout << RESET;
                     }
                     break;
                 }
                 case 3: {
-                    BufferManager buffer_manager;
-                    GraphManager graph_manager(buffer_manager);
-                    std::cout << PROMPT_COLOR << "Populating graph database...\n" << RESET;
-                    auto name_to_node_id = populateGraph(graph_manager);
+                    LoadedGraph& loaded = openGraph();
+                    GraphManager& graph_manager = *loaded.graph_manager;
 
                     std::string name;
                     std::cout << PROMPT_COLOR << "Enter the name of the person: " << RESET;
                     std::cin.ignore();
                     std::getline(std::cin, name);
 
-                    if (name_to_node_id.find(name) == name_to_node_id.end()) {
+                    auto node_id = loaded.findUser(name);
+                    if (!node_id.has_value()) {
                         std::cerr << RESULT_COLOR << "Error: Name not found in the database.\n" << RESET;
                         break;
                     }
 
                     std::cout << PROMPT_COLOR << "Finding connections and likes for " << name << "...\n" << RESET;
                     auto start_time = std::chrono::high_resolution_clock::now();
-                    auto connections = graph_manager.findConnectionsAndLikes(name_to_node_id[name]);
+                    auto connections = graph_manager.findConnectionsAndLikes(*node_id);
                     auto end_time = std::chrono::high_resolution_clock::now();
 
                     std::chrono::duration<double> duration = end_time - start_time;